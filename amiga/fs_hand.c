@@ -187,6 +187,7 @@ main(int argc, char *argv[])
         return (1);
     }
     cpu_control_init();
+    sm_file_channel = 1;  // Don't queue behind smashftp, which uses channel 0
 
     for (arg = 1; arg < argc; arg++) {
         const char *ptr = argv[arg];
@@ -435,6 +435,16 @@ FillInfoBlock(FileInfoBlock_t *fib, fileattr_t *fattr, hm_fdirent_t *dent)
 
     fib->fib_Comment[0] = 0;
     fib->fib_Comment[1] = '\0';
+    if (dent->hmd_type != HM_TYPE_LINK) {
+        /* Comment (if any) follows the name */
+        char *comment = dname + strlen(dname) + 1;
+        uint  clen = strlen(comment);
+        if (clen > sizeof (fib->fib_Comment) - 2)
+            clen = sizeof (fib->fib_Comment) - 2;
+        memcpy(fib->fib_Comment + 1, comment, clen);
+        fib->fib_Comment[clen + 1] = '\0';
+        fib->fib_Comment[0] = clen;
+    }
     fib->fib_OwnerUID = dent->hmd_ouid;
     fib->fib_OwnerGID = dent->hmd_ogid;
 
@@ -970,7 +980,6 @@ action_read(void)
     LONG          len = (LONG) GARG3;
     handle_t      handle;
     uint          rc = 0;
-    void         *data;
     uint          rlen;
     uint          count = 0;
     uint          buflen = 16384;
@@ -985,7 +994,7 @@ action_read(void)
     printf("READ %x at pos=%llx len=%x\n", handle, fp->fp_pos_cur, len);
 
     while (count < len) {
-        rc = sm_fread(handle, len, &data, &rlen, 0);
+        rc = sm_fread_buf(handle, buf, len - count, &rlen, 0);
         if ((rc != 0) && (rc != KM_STATUS_EOF))
             printf("sm_fread got %d\n", rc);
         if (rlen == 0) {
@@ -993,9 +1002,6 @@ action_read(void)
                    handle, fp->fp_pos_cur, count, rc);
             break;
         }
-        if (rlen > len)
-            rlen = len;
-        memcpy(buf, data, rlen);
         buf            += rlen;
         count          += rlen;
         fp->fp_pos_cur += rlen;
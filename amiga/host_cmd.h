@@ -12,6 +12,13 @@
 #ifndef _HOST_CMD_H
 #define _HOST_CMD_H
 
+/*
+ * Largest single message frame which the USB host sends to the Amiga,
+ * including the message header. Longer messages are sent as several
+ * frames, each repeating the header.
+ */
+#define KM_UTOA_FRAME_MAX     2000
+
 /* Operations which apply to message payload header km_op */
 #define KM_OP_NULL            0x00  // Do nothing (discard message)
 #define KM_OP_NOP             0x01  // Do nothing but reply
@@ -533,16 +533,27 @@ send_cmd_retry(uint16_t cmd, void *arg, uint16_t arglen,
 
     do {
         rc = send_cmd(cmd, arg, arglen, reply, replymax, replyalen);
-        if (rc == MSG_STATUS_SUCCESS)
-            break;
+        if ((rc == MSG_STATUS_SUCCESS) || (rc == KS_STATUS_UNKCMD))
+            break;  // Retry won't help if firmware doesn't know the command
     } while (--tries > 0);
     return (rc);
 }
 
+/*
+ * The bank snapshot holds ID and NV information which were acquired
+ * together with the bank information by get_banks(). Each part is
+ * consumed by the first get_id() or get_bank_timeout() which follows,
+ * so any later calls will fetch fresh information.
+ */
+static bank_snapshot_t snapshot;
+static uint8_t         snapshot_have_id;
+static uint8_t         snapshot_have_nv;
+
 /*
  * get_banks
  * ---------
- * Acquire ROM bank information from KickSmash
+ * Acquire ROM bank information from KickSmash. If the firmware supports
+ * it, ID and NV information are acquired in the same request.
  */
 static int
 get_banks(bank_info_t *bi)
@@ -568,6 +579,16 @@ get_banks(bank_info_t *bi)
 #else
     int rc;
     uint rlen;
+    rc = send_cmd_retry(KS_CMD_BANK_SNAPSHOT, NULL, 0,
+                        &snapshot, sizeof (snapshot), &rlen);
+    if ((rc == 0) && (rlen >= sizeof (snapshot))) {
+        memcpy(bi, &snapshot.bs_info, sizeof (*bi));
+        snapshot_have_id = TRUE;
+        snapshot_have_nv = TRUE;
+        return (0);
+    }
+
+    /* Older firmware: bank information only */
     rc = send_cmd_retry(KS_CMD_BANK_INFO, NULL, 0, bi, sizeof (*bi), &rlen);
     if (rc != 0)
         update_status("FAIL info %d", rc);
@@ -601,10 +622,16 @@ get_bank_timeout(uint *seconds, uint8_t *bank)
     *seconds = 0;
     *bank = 0;
 
-    buf[0] = 0;  // Start at NV0
-    buf[1] = 4;  // Also read NV1
-    rc = send_cmd_retry(KS_CMD_GET | KS_GET_NV,
-                        buf, sizeof (buf), rbuf, sizeof (rbuf), &rlen);
+    if (snapshot_have_nv) {
+        snapshot_have_nv = FALSE;
+        memcpy(rbuf, snapshot.bs_nv, sizeof (rbuf));
+        rc = 0;
+    } else {
+        buf[0] = 0;  // Start at NV0
+        buf[1] = 4;  // Also read NV1
+        rc = send_cmd_retry(KS_CMD_GET | KS_GET_NV,
+                            buf, sizeof (buf), rbuf, sizeof (rbuf), &rlen);
+    }
     if (rc == 0) {
         uint8_t data = rbuf[0];
         if (data & 0x80)
@@ -677,6 +704,11 @@ get_id(smash_id_t *id)
 #else
     int rc;
     uint rlen;
+    if (snapshot_have_id) {
+        snapshot_have_id = FALSE;
+        memcpy(id, &snapshot.bs_id, sizeof (*id));
+        return;
+    }
     rc = send_cmd_retry(KS_CMD_ID, NULL, 0, id, sizeof (*id), &rlen);
     if (rc != 0)
         update_status("FAIL id %d", rc);
@@ -22,11 +22,15 @@
 
 static uint     sm_mbuf_size = 0;
 static uint8_t *sm_mbuf      = NULL;
+uint8_t         sm_file_channel = 0;  // Preferred message channel
 
 /*
  * sm_fservice
  * -----------
  * Returns non-zero if the host is connected and providing file service.
+ * The preferred message channel, sm_file_channel, is selected only if the
+ * host reports that it services all message channels. Otherwise, channel
+ * 0 is used.
  */
 uint
 sm_fservice(void)
@@ -38,6 +42,10 @@ sm_fservice(void)
     if ((rc == 0) &&
         ((states[1] & (MSG_STATE_SERVICE_UP | MSG_STATE_HAVE_FILE)) ==
                       (MSG_STATE_SERVICE_UP | MSG_STATE_HAVE_FILE))) {
+        if (states[1] & MSG_STATE_HAVE_CHANNELS)
+            sm_msg_channel = sm_file_channel;
+        else
+            sm_msg_channel = 0;
         sm_file_active = 1;
         return (1);
     }
@@ -178,19 +186,15 @@ sm_fclose(handle_t handle)
 }
 
 /*
- * sm_fread
- * --------
- * Returns data contents from the USB host's file handle, which could
- * be from the contents of a file or directory entries.
- *
- * handle is the remote file handle: see sm_fopen().
- * readsize is the maximum size of data to acquire.
- * data is a pointer which is returned by this function.
- *      Note that data is from a static buffer not allocated by the caller.
- * rlen is the size of the received content (pointed to by data).
+ * sm_fread_common
+ * ---------------
+ * Implements sm_fread() and sm_fread_buf(). If buf is not NULL, a reply
+ * which spans multiple messages is received directly into buf rather than
+ * into the shared sm_mbuf, and data will point to buf.
  */
-uint
-sm_fread(handle_t handle, uint readsize, void **data, uint *rlen, uint flags)
+static uint
+sm_fread_common(handle_t handle, uint readsize, void *buf, void **data,
+                uint *rlen, uint flags)
 {
     uint rc;
     hm_freadwrite_t msg;
@@ -233,24 +237,28 @@ sm_fread(handle_t handle, uint readsize, void **data, uint *rlen, uint flags)
         /* More packets are inbound */
         uint total_len = rdata->hm_length;
         uint tag = msg.hm_hdr.km_tag;
-
-        if ((sm_mbuf == NULL) || (total_len >= sm_mbuf_size))  {
-            if (sm_mbuf != NULL)
-                free(sm_mbuf);
-            sm_mbuf      = malloc(total_len);
-            sm_mbuf_size = total_len;
-        }
-        if (sm_mbuf == NULL) {
-            printf("malloc(%u) failed\n", total_len);
-            rc = MSG_STATUS_NO_MEM;
-            goto sm_read_fail;
+        uint8_t *dbuf = buf;
+
+        if ((dbuf == NULL) || (total_len > readsize)) {
+            if ((sm_mbuf == NULL) || (total_len >= sm_mbuf_size))  {
+                if (sm_mbuf != NULL)
+                    free(sm_mbuf);
+                sm_mbuf      = malloc(total_len);
+                sm_mbuf_size = total_len;
+            }
+            if (sm_mbuf == NULL) {
+                printf("malloc(%u) failed\n", total_len);
+                rc = MSG_STATUS_NO_MEM;
+                goto sm_read_fail;
+            }
+            dbuf = sm_mbuf;
         }
-        memcpy(sm_mbuf, (rdata + 1), rcvlen);
-        rc = host_recv_msg_cont(tag, sm_mbuf + rcvlen, total_len - rcvlen);
+        memcpy(dbuf, (rdata + 1), rcvlen);
+        rc = host_recv_msg_cont(tag, dbuf + rcvlen, total_len - rcvlen);
         if (rc != KM_STATUS_OK)
             goto sm_read_fail;
         rcvlen = total_len;
-        *data = (void *) sm_mbuf;
+        *data = (void *) dbuf;
     }
 sm_read_fail:
     if (rlen != NULL)
@@ -263,6 +271,54 @@ sm_read_fail:
     return (rc);
 }
 
+/*
+ * sm_fread
+ * --------
+ * Returns data contents from the USB host's file handle, which could
+ * be from the contents of a file or directory entries.
+ *
+ * handle is the remote file handle: see sm_fopen().
+ * readsize is the maximum size of data to acquire.
+ * data is a pointer which is returned by this function.
+ *      Note that data is from a static buffer not allocated by the caller.
+ * rlen is the size of the received content (pointed to by data).
+ */
+uint
+sm_fread(handle_t handle, uint readsize, void **data, uint *rlen, uint flags)
+{
+    return (sm_fread_common(handle, readsize, NULL, data, rlen, flags));
+}
+
+/*
+ * sm_fread_buf
+ * ------------
+ * Reads data from the USB host's file handle into the caller's buffer.
+ * Large replies are received directly into the buffer, avoiding a copy
+ * through the shared message buffer.
+ *
+ * handle is the remote file handle: see sm_fopen().
+ * buf is the destination buffer. Data is received in place only where
+ *     the buffer is 16-bit aligned.
+ * readsize is the size of the buffer and maximum size of data to acquire.
+ * rlen is the size of the received content.
+ */
+uint
+sm_fread_buf(handle_t handle, void *buf, uint readsize, uint *rlen, uint flags)
+{
+    void *data;
+    uint  rcvlen = 0;
+    uint  rc;
+
+    rc = sm_fread_common(handle, readsize, buf, &data, &rcvlen, flags);
+    if (rcvlen > readsize)
+        rcvlen = readsize;
+    if ((rcvlen != 0) && (data != buf))
+        memcpy(buf, data, rcvlen);
+    if (rlen != NULL)
+        *rlen = rcvlen;
+    return (rc);
+}
+
 /*
  * sm_fwrite
  * ---------
@@ -18,6 +18,8 @@ uint sm_fopen(handle_t parent_handle, const char *name, uint mode,
 uint sm_fclose(handle_t handle);
 uint sm_fread(handle_t handle, uint readsize, void **data, uint *rlen,
               uint flags);
+uint sm_fread_buf(handle_t handle, void *buf, uint readsize, uint *rlen,
+                  uint flags);
 uint sm_fwrite(handle_t handle, void *buf, uint writelen, uint padded_header,
                uint flags);
 uint sm_fpath(handle_t handle, char **name);
@@ -36,6 +38,7 @@ uint sm_fsetprotect(handle_t parent_handle, const char *name, uint perms);
 const char *km_status(uint km_status);
 
 extern uint8_t sm_file_active;
+extern uint8_t sm_file_channel;
 
 #define SEEK_OFFSET_BEGINNING (-1)
 #define SEEK_OFFSET_CURRENT   (0)
@@ -31,6 +31,7 @@
 #define ROM_BASE         0x00f80000  /* Base address of Kickstart ROM */
 
 uint smash_cmd_shift = 2;
+uint sm_msg_channel  = 0;  // Message channel used for host messages
 extern uint flag_debug;
 
 #ifndef ROMFS
@@ -380,15 +381,17 @@ uint
 recv_msg(void *buf, uint len, uint *rlen, uint timeout_ms)
 {
     uint rc;
-    rc = send_cmd(KS_CMD_MSG_RECEIVE, NULL, 0, buf, len, rlen);
+    uint cmd = KS_CMD_MSG_RECEIVE | KS_MSG_CHANNEL(sm_msg_channel);
+
+    rc = send_cmd(cmd, NULL, 0, buf, len, rlen);
     timeout_ms /= 2;
     while (rc == KS_STATUS_NODATA) {
         cia_spin(CIA_USEC(600));
-        rc = send_cmd(KS_CMD_MSG_RECEIVE, NULL, 0, buf, len, rlen);
+        rc = send_cmd(cmd, NULL, 0, buf, len, rlen);
         if (timeout_ms-- == 0)
             break;
     }
-    if (rc == KS_CMD_MSG_SEND)
+    if ((rc & ~KS_MSG_CHAN_MASK) == KS_CMD_MSG_SEND)
         rc = KM_STATUS_OK;
     if (rc != KM_STATUS_OK) {
         printf("Get message failed: (%s)\n", smash_err(rc));
@@ -449,6 +452,7 @@ host_send_msg(void *smsg, uint len)
 {
     uint8_t savebuf[sizeof (km_msg_hdr_t)];
     uint32_t rbuf[16];
+    uint cmd = KS_CMD_MSG_SEND | KS_MSG_CHANNEL(sm_msg_channel);
     uint sendlen = len;
     uint pos;
     uint rc;
@@ -456,7 +460,7 @@ host_send_msg(void *smsg, uint len)
     if (sendlen > SEND_MSG_MAX)
         sendlen = SEND_MSG_MAX;
 
-    rc = send_cmd(KS_CMD_MSG_SEND, smsg, sendlen, rbuf, sizeof (rbuf), NULL);
+    rc = send_cmd(cmd, smsg, sendlen, rbuf, sizeof (rbuf), NULL);
     if ((rc == 0) && (sendlen < len)) {
         uint timeout = 0;
         pos = sendlen - sizeof (km_msg_hdr_t);
@@ -472,7 +476,7 @@ host_send_msg(void *smsg, uint len)
 #ifdef DEBUG_SEND_MSG
             printf("send %x pos=%x of %x\n", sendlen, pos, len);
 #endif
-            rc = send_cmd(KS_CMD_MSG_SEND, smsg + pos, sendlen, NULL, 0, NULL);
+            rc = send_cmd(cmd, smsg + pos, sendlen, NULL, 0, NULL);
             memcpy(smsg + pos, savebuf, sizeof (km_msg_hdr_t));
 // XXX: If we get KS_STATUS_BADLEN, this means that there wasn't enough
 //      space available in the KS buffer. Try again.
@@ -507,38 +511,37 @@ host_send_msg(void *smsg, uint len)
 }
 
 /*
- * host_recv_msg
- * -------------
- * Receive a single message from the USB host, returning a pointer to the
- * buffer containing the message content.
+ * host_recv_msg_buf
+ * -----------------
+ * Receive a single message from the USB host into the specified buffer.
+ * Messages not matching the specified tag are discarded.
  *
  * tag is the unique message tag for this transaction; see host_tag_alloc().
- * rdata is a pointer which will be assigned the address where the received
- *     message will be returned.
+ * buf is the buffer which will receive the message, including its header.
+ *     This buffer must be 16-bit aligned.
+ * buflen is the size of the buffer.
  * rlen is a pointer to the received data length which will be returned.
  */
-uint
-host_recv_msg(uint tag, void **rdata, uint *rlen)
+static uint
+host_recv_msg_buf(uint tag, void *buf, uint buflen, uint *rlen)
 {
-    static uint8_t buf[4200];
     km_msg_hdr_t *msg = (km_msg_hdr_t *)buf;
     uint rc;
     uint rxlen;
     uint count;
 
     for (count = 0; count < 50; count++) {
-        rc = recv_msg(buf, sizeof (buf), &rxlen, 500);  // 500 ms timeout
+        rc = recv_msg(buf, buflen, &rxlen, 500);  // 500 ms timeout
         if ((rc != KM_STATUS_OK) && (rc != KM_STATUS_EOF))
             return (rc);
         if (tag == msg->km_tag) {
             /* Got desired message */
-            if (rxlen > sizeof (buf)) {
+            if (rxlen > buflen) {
                 printf("BUG: Rx message op=%x stat=%x too large (%u > %u)\n",
-                       msg->km_op, msg->km_status, rxlen, sizeof (buf));
-                rxlen = sizeof (buf);
+                       msg->km_op, msg->km_status, rxlen, buflen);
+                rxlen = buflen;
             }
             *rlen = rxlen;
-            *rdata = buf;
             if (rc == KM_STATUS_OK)
                 rc = msg->km_status;
             return (rc);
@@ -551,12 +554,40 @@ host_recv_msg(uint tag, void **rdata, uint *rlen)
     return (KM_STATUS_FAIL);
 }
 
+/*
+ * host_recv_msg
+ * -------------
+ * Receive a single message from the USB host, returning a pointer to the
+ * buffer containing the message content.
+ *
+ * tag is the unique message tag for this transaction; see host_tag_alloc().
+ * rdata is a pointer which will be assigned the address where the received
+ *     message will be returned.
+ * rlen is a pointer to the received data length which will be returned.
+ */
+uint
+host_recv_msg(uint tag, void **rdata, uint *rlen)
+{
+    static uint16_t buf[4200 / 2];
+
+    *rdata = buf;
+    return (host_recv_msg_buf(tag, buf, sizeof (buf), rlen));
+}
+
 /*
  * host_recv_msg_cont
  * ------------------
  * Continue the previous message receive, stripping the header and just
  * copying data to the specified buffer.
  *
+ * Where possible, each message is received directly into the caller's
+ * buffer, overlapping its header with the tail of data already received.
+ * That tail is saved and restored around the receive, so payload bytes
+ * are written only once. If the buffer position is not suitably aligned,
+ * or too little of the buffer remains to hold a full host message frame
+ * (KM_UTOA_FRAME_MAX), the message is received in the static buffer and
+ * copied.
+ *
  * tag is the unique message tag for this transaction; see host_tag_alloc().
  *     It should be the same tag which was used to receive the lead message.
  * buf is a pointer to the buffer for the remaining message payload.
@@ -566,13 +597,28 @@ host_recv_msg(uint tag, void **rdata, uint *rlen)
 uint
 host_recv_msg_cont(uint tag, void *buf, uint buf_len)
 {
+    uint8_t  savebuf[sizeof (km_msg_hdr_t)];
     uint8_t *rdata;
+    uint8_t *dst;
     uint     rcvlen;
     uint     cur_len = 0;
     uint     rc;
 
     while (cur_len < buf_len) {
-        rc = host_recv_msg(tag, (void **) &rdata, &rcvlen);
+        dst = (uint8_t *) buf + cur_len - sizeof (km_msg_hdr_t);
+        if ((cur_len >= sizeof (km_msg_hdr_t)) &&
+            (buf_len - cur_len + sizeof (km_msg_hdr_t) >=
+             KM_UTOA_FRAME_MAX) &&
+            (((uintptr_t) dst & 1) == 0) && (((buf_len - cur_len) & 1) == 0)) {
+            /* Receive in place, after the data already received */
+            memcpy(savebuf, dst, sizeof (km_msg_hdr_t));
+            rc = host_recv_msg_buf(tag, dst, buf_len - cur_len +
+                                   sizeof (km_msg_hdr_t), &rcvlen);
+            memcpy(dst, savebuf, sizeof (km_msg_hdr_t));
+            rdata = NULL;
+        } else {
+            rc = host_recv_msg(tag, (void **) &rdata, &rcvlen);
+        }
         if (rc == KM_STATUS_EOF)
             rc = KM_STATUS_OK;
         if (rc != KM_STATUS_OK) {
@@ -589,7 +635,8 @@ host_recv_msg_cont(uint tag, void *buf, uint buf_len)
         else
             rcvlen = 0;
 
-        memcpy(buf + cur_len, rdata + sizeof (km_msg_hdr_t), rcvlen);
+        if (rdata != NULL)
+            memcpy(buf + cur_len, rdata + sizeof (km_msg_hdr_t), rcvlen);
         cur_len += rcvlen;
     }
     return (KM_STATUS_OK);
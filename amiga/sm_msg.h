@@ -56,5 +56,6 @@ void dump_memory(void *buf, uint len, uint dump_base);
 const char *smash_err(uint status);
 
 extern uint smash_cmd_shift;
+extern uint sm_msg_channel;
 
 #endif /* _MSG_H */
@@ -73,9 +73,13 @@ static const channel_gpio_t channel_gpios[] = {
 };
 
 #define CHANNEL_COUNT ARRAY_SIZE(channel_defs)
+#define ADC_SCANS     8  // Number of scans averaged for each reading
 
-/* Buffer to store the results of the ADC conversion */
-volatile uint16_t adc_buffer[CHANNEL_COUNT];
+/*
+ * Circular buffer of the most recent ADC scans. The ADC converts all
+ * channels continuously, and DMA stores each scan in the next row.
+ */
+volatile uint16_t adc_buffer[ADC_SCANS][CHANNEL_COUNT];
 
 int v5_stable = false;
 
@@ -111,7 +115,7 @@ adc_init(void)
     dma_set_peripheral_address(dma, channel, (uintptr_t)&ADC_DR(adcbase));
     dma_set_memory_address(dma, channel, (uintptr_t)adc_buffer);
     dma_set_read_from_peripheral(dma, channel);
-    dma_set_number_of_data(dma, channel, CHANNEL_COUNT);
+    dma_set_number_of_data(dma, channel, ADC_SCANS * CHANNEL_COUNT);
     dma_disable_peripheral_increment_mode(dma, channel);
     dma_enable_memory_increment_mode(dma, channel);
     dma_set_peripheral_size(dma, channel, DMA_CCR_PSIZE_16BIT);
@@ -150,6 +154,27 @@ adc_shutdown(void)
     dma_disable_channel(DMA1, DMA_CHANNEL1);
 }
 
+/*
+ * adc_read
+ * --------
+ * Computes the average of each channel across the most recent ADC scans.
+ * A scan may be in progress, but each sample is a complete conversion.
+ */
+static void
+adc_read(uint16_t *adc)
+{
+    uint ch;
+    uint scan;
+    uint sum;
+
+    for (ch = 0; ch < CHANNEL_COUNT; ch++) {
+        sum = 0;
+        for (scan = 0; scan < ADC_SCANS; scan++)
+            sum += adc_buffer[scan][ch];
+        adc[ch] = (sum + ADC_SCANS / 2) / ADC_SCANS;
+    }
+}
+
 static void
 print_reading(int value, char *suffix)
 {
@@ -223,18 +248,18 @@ adc_show_sensors(void)
      * Calc      * 10000 / 25 - 279000   * 10000 / 43 - 279000
      *
      * Channel order (STM32F1):
-     *     adc_buffer[0] = Vrefint
-     *     adc_buffer[1] = Vtemperature
+     *     adc[0] = Vrefint
+     *     adc[1] = Vtemperature
      *
      * Algorithm:
      *  * Vrefint tells us what 1.21V (STM32F407) or 1.20V (STM32F1xx) should
      *  be according to ADCs.
-     *  1. scale = 1.2 / adc_buffer[0]
+     *  1. scale = 1.2 / adc[0]
      *          Because: reading * scale = 1.2V
      *  2. Report Vbat:
-     *          adc_buffer[1] * scale * 2
+     *          adc[1] * scale * 2
      */
-    memcpy(adc, (void *)adc_buffer, sizeof (adc_buffer));
+    adc_read(adc);
     scale = adc_get_scale(adc[0]);
 
     uint calc_temp;
@@ -258,8 +283,9 @@ adc_show_sensors(void)
 }
 
 /*
- * adc_poll() will capture the current readings from the sensors and take
- *            action to maintain the 10V rail as close as possible to 10V.
+ * adc_poll() will capture the current readings from the sensors and report
+ *            changes in stability of the Amiga 5V rail. Readings are
+ *            already averaged across ADC_SCANS, so this need not run often.
  */
 void
 adc_poll(int verbose, int force)
@@ -274,9 +300,9 @@ adc_poll(int verbose, int force)
 
     if ((timer_tick_has_elapsed(next_check) == false) && (force == false))
         return;
-    next_check = timer_tick_plus_msec(1);  // Limit rate to prevent overshoot
+    next_check = timer_tick_plus_msec(10);
 
-    memcpy(adc, (void *)adc_buffer, sizeof (adc_buffer));
+    adc_read(adc);
     scale = adc_get_scale(adc[0]);
     calc_v5 = adc[2] * scale * V5_DIVIDER_SCALE;
     if (avg_v5 == 0)
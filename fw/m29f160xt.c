@@ -34,7 +34,6 @@
 #undef  DEBUG_SIGNALS
 
 #define EE_DEVICE_SIZE          (1 << 20)   // 1M words (16-bit words)
-#define MX_ERASE_SECTOR_SIZE    (32 << 10)  // 32K-word blocks
 
 #define MX_STATUS_FAIL_PROGRAM  0x10  // Status code - failed to program
 #define MX_STATUS_FAIL_ERASE    0x20  // Status code - failed to erase
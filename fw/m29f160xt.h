@@ -48,6 +48,8 @@ void     oe_output_disable(void);
 #define MX_ERASE_MODE_CHIP   0
 #define MX_ERASE_MODE_SECTOR 1
 
+#define MX_ERASE_SECTOR_SIZE (32 << 10)  // 32K-word blocks
+
 #define EE_MODE_32      0  // 32-bit flash
 #define EE_MODE_16_LOW  1  // 16-bit flash low device (bits 0-15)
 #define EE_MODE_16_HIGH 2  // 16-bit flash high device (bits 16-31)
@@ -42,9 +42,14 @@ reset_periphs(void)
     RCC_APB2RSTR = 0x00000000;  // Release APB2 reset
 }
 
+uint64_t main_poll_max_ticks;  // Longest main_poll() pass (see usb stats)
+
 void
 main_poll(void)
 {
+    uint64_t start = timer_tick_get();
+    uint64_t ticks;
+
     usb_poll();
     adc_poll(true, false);
     ee_poll();
@@ -52,6 +57,10 @@ main_poll(void)
     config_poll();
     msg_poll();
     led_poll();
+
+    ticks = timer_tick_get() - start;
+    if (main_poll_max_ticks < ticks)
+        main_poll_max_ticks = ticks;
 }
 
 extern uint _binary_objs_usbdfu_bin_start;
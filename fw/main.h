@@ -12,8 +12,12 @@
 #ifndef _MAIN_H
 #define _MAIN_H
 
+#include <stdint.h>
+
 typedef unsigned int uint;
 
 void main_poll(void);
 
+extern uint64_t main_poll_max_ticks;
+
 #endif /* _MAIN_H */
@@ -21,6 +21,8 @@
 #include "main.h"
 #include "msg.h"
 #include "m29f160xt.h"
+#include "cmdline.h"
+#include "prom_access.h"
 #include "timer.h"
 #include "utils.h"
 #include "gpio.h"
@@ -118,7 +120,8 @@ static uint     ks_timeout_count = 0;  // count of complaint messages
 
 static uint     consumer_spin;
 static uint8_t  capture_mode = CAPTURE_ADDR;
-static uint8_t  msg_lock;       // Bits !USB 0=atou 1=utoa, !Amiga 2=atou 3=utoa
+static uint8_t  msg_lock[KS_MSG_CHANNELS];  // Bits !USB 0=atou 1=utoa,
+                                            //      !Amiga 2=atou 3=utoa
 static uint     consumer_wrap;
 static uint     consumer_wrap_last_poll;
 static uint     rx_consumer = 0;
@@ -129,10 +132,15 @@ static uint16_t state_amiga_app;          // Amiga app state
 static uint16_t state_usb_app;            // USB app state
 
 /* Message interface through Kicksmash between Amiga and USB host */
-static uint     prod_atou;      // Producer for Amiga -> USB buffer
-static uint     cons_atou;      // Consumer for Amiga -> USB buffer
-static uint     prod_utoa;      // Producer for USB buffer -> Amiga
-static uint     cons_utoa;      // Consumer for USB buffer -> Amiga
+typedef struct {
+    uint8_t *mq_buf;            // Circular buffer
+    uint     mq_size;           // Buffer size (power-of-2)
+    uint     mq_prod;           // Producer offset
+    uint     mq_cons;           // Consumer offset
+} msg_queue_t;
+
+static msg_queue_t msg_q_atou[KS_MSG_CHANNELS];  // Amiga -> USB by channel
+static msg_queue_t msg_q_utoa[KS_MSG_CHANNELS];  // USB -> Amiga by channel
 static uint     messages_atou;  // Count of Amiga-to-USB messages
 static uint     messages_utoa;  // Count of USB-to-Amiga messages
 static uint     messages_amiga; // Messages sent by Amiga
@@ -151,8 +159,10 @@ ALIGN volatile uint16_t          buffer_txd_lo[ADDR_BUF_COUNT * 2];
 ALIGN volatile uint16_t          buffer_txd_hi[ADDR_BUF_COUNT];
 
 /* The message buffers must be a power-of-2 in size */
-ALIGN uint8_t  msg_atou[0x1000];  // Amiga -> USB buffer
-ALIGN uint8_t  msg_utoa[0x1000];  // USB -> Amiga buffer
+ALIGN uint8_t  msg_atou[0x1000];  // Amiga -> USB buffer (channel 0)
+ALIGN uint8_t  msg_utoa[0x1000];  // USB -> Amiga buffer (channel 0)
+ALIGN uint8_t  msg_chan_atou[KS_MSG_CHANNELS - 1][0x800];  // Other channels
+ALIGN uint8_t  msg_chan_utoa[KS_MSG_CHANNELS - 1][0x800];
 
 #ifdef CAPTURE_GPIOS
 ALIGN uint16_t buffer_a[ADDR_BUF_COUNT];
@@ -286,109 +296,115 @@ gpio_showbuf(uint count)
  * against the total_size - 1. That will yield a positive which is the
  * number of elements in use.
  */
-#define SPACE_INUSE_ATOU ((prod_atou - cons_atou) & (sizeof (msg_atou) - 1))
-#define SPACE_INUSE_UTOA ((prod_utoa - cons_utoa) & (sizeof (msg_utoa) - 1))
-#define SPACE_AVAIL_ATOU (sizeof (msg_atou) - 2 - SPACE_INUSE_ATOU)
-#define SPACE_AVAIL_UTOA (sizeof (msg_utoa) - 2 - SPACE_INUSE_UTOA)
-
-static uint
-atou_add(uint len, void *ptr)
-{
-    uint xlen;
-    uint8_t *sptr = ptr;
-    len = (len + 1) & ~1;  // Round up to 16-bit alignment
-    if (len > SPACE_AVAIL_ATOU)
-        return (1);
-    xlen = sizeof (msg_atou) - prod_atou;
-    if (len <= xlen) {
-        memcpy(msg_atou + prod_atou, sptr, len);
-    } else {
-        memcpy(msg_atou + prod_atou, sptr, xlen);
-        memcpy(msg_atou, sptr + xlen, len - xlen);
-    }
-    prod_atou = (prod_atou + len) & (sizeof (msg_atou) - 1);
-    messages_atou++;
-    return (0);
-}
+#define SPACE_INUSE(mq) (((mq)->mq_prod - (mq)->mq_cons) & ((mq)->mq_size - 1))
+#define SPACE_AVAIL(mq) ((mq)->mq_size - 2 - SPACE_INUSE(mq))
 
+/*
+ * msgq_add
+ * --------
+ * Appends data to a message queue. Returns non-zero if there is not
+ * sufficient space available.
+ */
 static uint
-utoa_add(uint len, void *ptr)
+msgq_add(msg_queue_t *mq, uint len, void *ptr)
 {
     uint xlen;
     uint8_t *sptr = ptr;
     len = (len + 1) & ~1;  // Round up to 16-bit alignment
-    if (len > SPACE_AVAIL_UTOA)
+    if (len > SPACE_AVAIL(mq))
         return (1);
-    xlen = sizeof (msg_utoa) - prod_utoa;
+    xlen = mq->mq_size - mq->mq_prod;
     if (len <= xlen) {
-        memcpy(msg_utoa + prod_utoa, sptr, len);
+        memcpy(mq->mq_buf + mq->mq_prod, sptr, len);
     } else {
-        memcpy(msg_utoa + prod_utoa, sptr, xlen);
-        memcpy(msg_utoa, sptr + xlen, len - xlen);
+        memcpy(mq->mq_buf + mq->mq_prod, sptr, xlen);
+        memcpy(mq->mq_buf, sptr + xlen, len - xlen);
     }
-    prod_utoa = (prod_utoa + len) & (sizeof (msg_utoa) - 1);
-    messages_utoa++;
+    mq->mq_prod = (mq->mq_prod + len) & (mq->mq_size - 1);
     return (0);
 }
 
+/*
+ * msgq_next_msg_len
+ * -----------------
+ * Returns the length of the next message in a message queue, including
+ * its header and CRC, or 0 if the queue is empty. A queue which does not
+ * hold a valid message is flushed.
+ */
 static uint16_t
-atou_next_msg_len(void)
+msgq_next_msg_len(msg_queue_t *mq)
 {
     uint     len;
     uint     pos;
-    uint     inuse = SPACE_INUSE_ATOU;
+    uint     inuse = SPACE_INUSE(mq);
     uint     count;
     uint16_t magic;
 
     if (inuse < KS_HDR_AND_CRC_LEN) {
         /* Invalid */
-        cons_atou = prod_atou;
+        mq->mq_cons = mq->mq_prod;
         return (0);
     }
 
     /* Check magic */
-    for (pos = cons_atou, count = 0; count < ARRAY_SIZE(sm_magic); count++) {
-        magic = *(uint16_t *) (msg_atou + pos);
+    for (pos = mq->mq_cons, count = 0; count < ARRAY_SIZE(sm_magic); count++) {
+        magic = *(uint16_t *) (mq->mq_buf + pos);
         if (magic != sm_magic[count]) {
             printf("Bad msg %u %04x != %04x\n", count, magic, sm_magic[count]);
-            cons_atou = prod_atou;
+            mq->mq_cons = mq->mq_prod;
             return (0);
         }
-        pos = (pos + 2) & (sizeof (msg_atou) - 1);
+        pos = (pos + 2) & (mq->mq_size - 1);
     }
 
-    len     = *(uint16_t *) (msg_atou + pos);
+    len     = *(uint16_t *) (mq->mq_buf + pos);
     len     = (len + 1) & ~1;  // Round up
     return (len + KS_HDR_AND_CRC_LEN);
 }
 
-static uint16_t
-utoa_next_msg_len(void)
+/*
+ * msgq_span
+ * ---------
+ * Returns the one or two regions of the circular buffer which hold the
+ * next <len> bytes of a message queue.
+ */
+static void
+msgq_span(msg_queue_t *mq, uint len, uint8_t **buf1, uint *len1,
+          uint8_t **buf2, uint *len2)
 {
-    uint     len;
-    uint     pos;
-    uint     inuse = SPACE_INUSE_UTOA;
-    uint     count;
-    uint16_t magic;
-
-    if (inuse < KS_HDR_AND_CRC_LEN) {
-        cons_utoa = prod_utoa;
-        return (0);
-    }
-    /* Check magic */
-    for (pos = cons_utoa, count = 0; count < ARRAY_SIZE(sm_magic); count++) {
-        magic = *(uint16_t *) (msg_utoa + pos);
-        if (magic != sm_magic[count]) {
-            printf("bad msg %u %04x != %04x\n", count, magic, sm_magic[count]);
-            cons_utoa = prod_utoa;
-            return (0);
-        }
-        pos = (pos + 2) & (sizeof (msg_utoa) - 1);
+    *len1 = mq->mq_size - mq->mq_cons;
+    if (*len1 > len) {
+        /* Data doesn't wrap */
+        *len1 = len;
+        *len2 = 0;
+    } else {
+        /* Data at end + beginning of circular buffer */
+        *len2 = len - *len1;
     }
+    *buf1 = mq->mq_buf + mq->mq_cons;
+    *buf2 = mq->mq_buf;
+}
 
-    len     = *(uint16_t *) (msg_utoa + pos);
-    len     = (len + 1) & ~1;  // Round up
-    return (len + KS_HDR_AND_CRC_LEN);
+/*
+ * msgq_consume
+ * ------------
+ * Removes <len> bytes from the head of a message queue.
+ */
+static void
+msgq_consume(msg_queue_t *mq, uint len)
+{
+    mq->mq_cons = (mq->mq_cons + len) & (mq->mq_size - 1);
+}
+
+/*
+ * msgq_flush
+ * ----------
+ * Discards all data in a message queue.
+ */
+static void
+msgq_flush(msg_queue_t *mq)
+{
+    mq->mq_cons = mq->mq_prod;
 }
 
 /*
@@ -949,6 +965,51 @@ oe_reply_end:
 #endif
 }
 
+/*
+ * smash_id_fill
+ * -------------
+ * Fill in KickSmash identification and configuration, as sent to the
+ * Amiga or USB host in response to KS_CMD_ID.
+ */
+static void
+smash_id_fill(smash_id_t *reply)
+{
+    uint temp[3];
+    int  pos = 0;
+    memset(reply, 0, sizeof (*reply));
+    sscanf(version_str + 8, "%u.%u%n", &temp[0], &temp[1], &pos);
+    reply->si_ks_version[0] = SWAP16(temp[0]);
+    reply->si_ks_version[1] = SWAP16(temp[1]);
+    if (pos == 0)
+        pos = 18;
+    else
+        pos += 8 + 7;
+    sscanf(version_str + pos, "%04u-%02u-%02u",
+           &temp[0], &temp[1], &temp[2]);
+    reply->si_ks_date[0] = temp[0] / 100;
+    reply->si_ks_date[1] = temp[0] % 100;
+    reply->si_ks_date[2] = temp[1];
+    reply->si_ks_date[3] = temp[2];
+    pos += 11;
+    sscanf(version_str + pos, "%02u:%02u:%02u",
+           &temp[0], &temp[1], &temp[2]);
+    reply->si_ks_time[0] = temp[0];
+    reply->si_ks_time[1] = temp[1];
+    reply->si_ks_time[2] = temp[2];
+    reply->si_ks_time[3] = 0;
+    strcpy(reply->si_serial, (const char *)usb_serial_str);
+    reply->si_rev      = SWAP16(0x0001);     // Protocol version 0.1
+    reply->si_features = SWAP16(KS_FEATURE_BASE |
+                                KS_FEATURE_MSG_RX_ALL |
+                                KS_FEATURE_MSG_RX_BATCH |
+                                KS_FEATURE_MSG_CHANNELS);  // Features
+    reply->si_usbid    = SWAP32(0x12091610); // Matches USB ID
+    reply->si_mode     = ee_mode;
+    reply->si_unused1  = 0;
+    reply->si_usbdev   = usb_current_address();
+    strcpy(reply->si_name, config.name);
+}
+
 static void
 execute_cmd(uint16_t cmd, uint16_t cmd_len)
 {
@@ -965,38 +1026,7 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
         case KS_CMD_ID: {
             /* Send KickSmash identification and configuration */
             smash_id_t reply;
-            uint temp[3];
-            uint pos = 0;
-            memset(&reply, 0, sizeof (reply));
-            sscanf(version_str + 8, "%u.%u%n", &temp[0], &temp[1], &pos);
-            reply.si_ks_version[0] = SWAP16(temp[0]);
-            reply.si_ks_version[1] = SWAP16(temp[1]);
-            if (pos == 0)
-                pos = 18;
-            else
-                pos += 8 + 7;
-            sscanf(version_str + pos, "%04u-%02u-%02u",
-                   &temp[0], &temp[1], &temp[2]);
-            reply.si_ks_date[0] = temp[0] / 100;
-            reply.si_ks_date[1] = temp[0] % 100;
-            reply.si_ks_date[2] = temp[1];
-            reply.si_ks_date[3] = temp[2];
-            pos += 11;
-            sscanf(version_str + pos, "%02u:%02u:%02u",
-                   &temp[0], &temp[1], &temp[2]);
-            reply.si_ks_time[0] = temp[0];
-            reply.si_ks_time[1] = temp[1];
-            reply.si_ks_time[2] = temp[2];
-            reply.si_ks_time[3] = 0;
-            strcpy(reply.si_serial, (const char *)usb_serial_str);
-            reply.si_rev      = SWAP16(0x0001);     // Protocol version 0.1
-            reply.si_features = SWAP16(0x0001);     // Features
-            reply.si_usbid    = SWAP32(0x12091610); // Matches USB ID
-            reply.si_mode     = ee_mode;
-            reply.si_unused1  = 0;
-            reply.si_usbdev   = usb_current_address();
-            strcpy(reply.si_name, config.name);
-            memset(reply.si_unused, 0, sizeof (reply.si_unused));
+            smash_id_fill(&reply);
             ks_reply(0, KS_STATUS_OK, sizeof (reply), &reply, 0, NULL);
             break;
         }
@@ -1286,6 +1316,15 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
             /* Get bank info */
             ks_reply(0, KS_STATUS_OK, sizeof (config.bi), &config.bi, 0, NULL);
             break;
+        case KS_CMD_BANK_SNAPSHOT: {
+            /* Get bank info, ID, and NV bytes in a single reply */
+            bank_snapshot_t reply;
+            memcpy(&reply.bs_info, &config.bi, sizeof (reply.bs_info));
+            smash_id_fill(&reply.bs_id);
+            memcpy(reply.bs_nv, config.nv_mem, sizeof (reply.bs_nv));
+            ks_reply(0, KS_STATUS_OK, sizeof (reply), &reply, 0, NULL);
+            break;
+        }
         case KS_CMD_BANK_SET: {
             /* Set ROM bank (options in high bits of command) */
             uint16_t bank;
@@ -1493,29 +1532,30 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
         }
         case KS_CMD_MSG_INFO: {
             smash_msg_info_t reply;
+            uint             chan = KS_MSG_CHAN_GET(cmd);
             uint16_t         avail_atou;
             uint16_t         avail_utoa;
             uint16_t         inuse_atou;
             uint16_t         inuse_utoa;
 
-            if (msg_lock & BIT(2)) {
+            if (msg_lock[chan] & BIT(2)) {
                 inuse_atou = 0;
                 avail_atou = 0;
             } else {
-                inuse_atou = SPACE_INUSE_ATOU;
-                avail_atou = SPACE_AVAIL_ATOU;
+                inuse_atou = SPACE_INUSE(&msg_q_atou[chan]);
+                avail_atou = SPACE_AVAIL(&msg_q_atou[chan]);
                 if (avail_atou >= KS_HDR_AND_CRC_LEN)
                     avail_atou -= KS_HDR_AND_CRC_LEN;
                 else
                     avail_atou = 0;
             }
 
-            if (msg_lock & BIT(3)) {
+            if (msg_lock[chan] & BIT(3)) {
                 inuse_utoa = 0;
                 avail_utoa = 0;
             } else {
-                inuse_utoa = SPACE_INUSE_UTOA;
-                avail_utoa = SPACE_AVAIL_UTOA;
+                inuse_utoa = SPACE_INUSE(&msg_q_utoa[chan]);
+                avail_utoa = SPACE_AVAIL(&msg_q_utoa[chan]);
                 if (avail_utoa >= KS_HDR_AND_CRC_LEN)
                     avail_utoa -= KS_HDR_AND_CRC_LEN;
                 else
@@ -1539,6 +1579,8 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
         }
         case KS_CMD_MSG_SEND: {
             uint raw_len = cmd_len + KS_HDR_AND_CRC_LEN;  // Magic+len+cmd+CRC
+            uint chan = KS_MSG_CHAN_GET(cmd);
+            msg_queue_t *mq;
             uint8_t *buf1;
             uint8_t *buf2;
             uint len1;
@@ -1546,21 +1588,21 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
             uint rc;
             cons_s = rx_consumer - (raw_len - 1) / 2;
 
-            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock & BIT(2))) ||
-                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock & BIT(3)))) {
+            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock[chan] & BIT(2))) ||
+                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock[chan] & BIT(3)))) {
                 ks_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                 break;
             }
+            if ((cmd & KS_MSG_ALTBUF) == 0)
+                mq = &msg_q_atou[chan];
+            else
+                mq = &msg_q_utoa[chan];
 
             if ((int) cons_s >= 0) {
                 /* Receive data doesn't wrap */
                 len1 = raw_len;
                 buf1 = (uint8_t *) &buffer_rxa_lo[cons_s];
-                if ((cmd & KS_MSG_ALTBUF) == 0) {
-                    rc = atou_add(len1, buf1);
-                } else {
-                    rc = utoa_add(len1, buf1);
-                }
+                rc = msgq_add(mq, len1, buf1);
             } else {
                 /* Send data from end of buffer + beginning of buffer */
                 cons_s += ARRAY_SIZE(buffer_rxa_lo);
@@ -1571,37 +1613,23 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
                 len2 = raw_len - len1;
                 buf2 = (uint8_t *) buffer_rxa_lo;
 
-                if ((cmd & KS_MSG_ALTBUF) == 0) {
-                    if (raw_len > SPACE_AVAIL_ATOU) {
-                        rc = 1;
-                    } else {
-                        rc = atou_add(len1, buf1);
-                        if (rc == 0) {
-                            rc = atou_add(len2, buf2);
-                            messages_atou--;
-                        }
-                    }
+                if (raw_len > SPACE_AVAIL(mq)) {
+                    rc = 1;
                 } else {
-                    if (raw_len > SPACE_AVAIL_UTOA) {
-                        rc = 1;
-                    } else {
-                        rc = utoa_add(len1, buf1);
-                        if (rc == 0) {
-                            rc = utoa_add(len2, buf2);
-                            messages_utoa--;
-                        }
-                    }
+                    rc = msgq_add(mq, len1, buf1);
+                    if (rc == 0)
+                        rc = msgq_add(mq, len2, buf2);
                 }
             }
             if (rc != 0) {
                 ks_reply(0, KS_STATUS_BADLEN, 0, NULL, 0, NULL);
             } else {
-#if 0
-                uint16_t space_avail;
                 if ((cmd & KS_MSG_ALTBUF) == 0)
-                    space_avail = SPACE_AVAIL_ATOU;
+                    messages_atou++;
                 else
-                    space_avail = SPACE_AVAIL_UTOA;
+                    messages_utoa++;
+#if 0
+                uint16_t space_avail = SPACE_AVAIL(mq);
                 ks_reply(0, KS_STATUS_OK, sizeof (space_avail), &space_avail,
                          0, NULL);
 #else
@@ -1611,58 +1639,37 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
             break;
         }
         case KS_CMD_MSG_RECEIVE: {
-            uint     len;
-            uint     len1;
-            uint     len2;
-            uint8_t *buf1;
-            uint8_t *buf2;
-
-            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock & BIT(3))) ||
-                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock & BIT(2)))) {
+            uint         chan = KS_MSG_CHAN_GET(cmd);
+            msg_queue_t *mq;
+            uint         len;
+            uint         len1;
+            uint         len2;
+            uint8_t     *buf1;
+            uint8_t     *buf2;
+
+            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock[chan] & BIT(3))) ||
+                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock[chan] & BIT(2)))) {
                 ks_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                 break;
             }
 
-            if ((cmd & KS_MSG_ALTBUF) == 0) {
-                len = utoa_next_msg_len();
-                len1 = sizeof (msg_utoa) - cons_utoa;
-                if (len1 > len) {
-                    /* Send data doesn't wrap */
-                    len1 = len;
-                    len2 = 0;
-                } else {
-                    /* Send data from end + beginning of circular buffer */
-                    len2 = len - len1;
-                }
-                buf1 = msg_utoa + cons_utoa;
-                buf2 = msg_utoa;
-            } else {
-                len = atou_next_msg_len();
-                len1 = sizeof (msg_atou) - cons_atou;
-                if (len1 > len) {
-                    /* Send data doesn't wrap */
-                    len1 = len;
-                    len2 = 0;
-                } else {
-                    /* Send data from end + beginning of circular buffer */
-                    len2 = len - len1;
-                }
-                buf1 = msg_atou + cons_atou;
-                buf2 = msg_atou;
-            }
+            if ((cmd & KS_MSG_ALTBUF) == 0)
+                mq = &msg_q_utoa[chan];
+            else
+                mq = &msg_q_atou[chan];
+            len = msgq_next_msg_len(mq);
             if (len == 0) {
                 ks_reply(0, KS_STATUS_NODATA, 0, NULL, 0, NULL);
                 break;
             }
 
+            msgq_span(mq, len, &buf1, &len1, &buf2, &len2);
             ks_reply(KS_REPLY_RAW, 0, len1, buf1, len2, buf2);
-            if ((cmd & KS_MSG_ALTBUF) == 0)
-                cons_utoa = (cons_utoa + len) & (sizeof (msg_utoa) - 1);
-            else
-                cons_atou = (cons_atou + len) & (sizeof (msg_atou) - 1);
+            msgq_consume(mq, len);
             break;
         }
         case KS_CMD_MSG_LOCK: {
+            uint chan = KS_MSG_CHAN_GET(cmd);
             uint lockbits;
             cons_s = rx_consumer - (cmd_len + 1) / 2 - 1;
             if ((int) cons_s < 0)
@@ -1670,26 +1677,28 @@ execute_cmd(uint16_t cmd, uint16_t cmd_len)
             lockbits = buffer_rxa_lo[cons_s];
 
             if (cmd & KS_MSG_UNLOCK) {
-                msg_lock &= ~lockbits;
+                msg_lock[chan] &= ~lockbits;
             } else {
-                if (((lockbits & BIT(0)) && (msg_lock & BIT(2))) ||
-                    ((lockbits & BIT(1)) && (msg_lock & BIT(3)))) {
+                if (((lockbits & BIT(0)) && (msg_lock[chan] & BIT(2))) ||
+                    ((lockbits & BIT(1)) && (msg_lock[chan] & BIT(3)))) {
                     /* Attempted to lock resource owned by the other side */
                     ks_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                     break;
                 }
-                msg_lock |= lockbits;
+                msg_lock[chan] |= lockbits;
             }
             ks_reply(0, KS_STATUS_OK, 0, NULL, 0, NULL);
             break;
         }
-        case KS_CMD_MSG_FLUSH:
+        case KS_CMD_MSG_FLUSH: {
+            uint chan = KS_MSG_CHAN_GET(cmd);
             if (cmd & KS_MSG_ALTBUF)
-                cons_atou = prod_atou;
+                msgq_flush(&msg_q_atou[chan]);
             else
-                cons_utoa = prod_utoa;  // default: flush "my" receive buffer
+                msgq_flush(&msg_q_utoa[chan]);  // default: "my" receive buffer
             ks_reply(0, KS_STATUS_OK, 0, NULL, 0, NULL);
             break;
+        }
         case KS_CMD_CLOCK: {
             uint64_t  now  = timer_tick_get();
             uint64_t  usec = timer_tick_to_usec(now);
@@ -2027,8 +2036,9 @@ address_log_replay(uint max)
                (uintptr_t)buffer_rxa_lo,
                consumer_wrap, consumer_spin, messages_amiga, messages_usb,
                fail_crc_a, fail_crc_u, fail_cmd_a, fail_cmd_u,
-               messages_atou, messages_utoa, prod_atou, prod_utoa,
-               cons_atou, cons_utoa);
+               messages_atou, messages_utoa,
+               msg_q_atou[0].mq_prod, msg_q_utoa[0].mq_prod,
+               msg_q_atou[0].mq_cons, msg_q_utoa[0].mq_cons);
         consumer_wrap = 0;
         consumer_spin = 0;
         messages_amiga = 0;
@@ -2201,6 +2211,117 @@ bus_snoop(uint mode)
     printf("\n");
 }
 
+/*
+ * snoop_frame_send
+ * ----------------
+ * Completes the snoop_frame_t header of a stream frame and sends the
+ * frame to the USB host. Returns non-zero if the send timed out.
+ */
+static int
+snoop_frame_send(uint8_t *frame, uint len, uint count, uint flags)
+{
+    snoop_frame_t *sf = (snoop_frame_t *) frame;
+
+    sf->sf_magic = SNOOP_FRAME_MAGIC;
+    sf->sf_flags = flags;
+    sf->sf_len   = len;
+    sf->sf_count = count;
+    sf->sf_crc   = crc32(0, frame + sizeof (*sf), len);
+    return (puts_binary(frame, sizeof (*sf) + len));
+}
+
+/*
+ * bus_snoop_stream
+ * ----------------
+ * Capture addresses of Amiga fetches from Kickstart ROM using DMA hardware
+ * and stream them to the USB host in binary snoop_frame_t frames. Each
+ * address is sent as a zigzag varint delta from the previous address,
+ * so sequential fetches take a single byte. A partial frame is sent once
+ * its first address is 10 ms old.
+ *
+ * The stream ends when any character is received from the host, or
+ * after <max> addresses have been sent (if max is not zero). The last
+ * frame has SNOOP_FRAME_END set.
+ */
+void
+bus_snoop_stream(uint max)
+{
+    static uint8_t frame[sizeof (snoop_frame_t) + SNOOP_FRAME_DATA_MAX];
+    uint8_t  *data  = frame + sizeof (snoop_frame_t);
+    uint      flags = 0;
+    uint      pos   = 0;
+    uint      count = 0;
+    uint      total = 0;
+    uint      polls = 0;
+    uint      cons;
+    uint      prod;
+    uint      dma_left;
+    uint32_t  last  = 0;
+    uint64_t  flush_time = 0;
+
+    if ((ee_mode == EE_MODE_32) || (ee_mode == EE_MODE_32_SWAP))
+        flags |= SNOOP_FRAME_32BIT;
+
+    address_output_disable();
+    capture_mode = CAPTURE_ADDR;
+    configure_oe_capture_rx(false);
+    TIM_CCER(TIM2) |= TIM_CCER_CC1E;  // timer_enable_oc_output()
+    dma_left = dma_get_number_of_data(LOG_DMA_CONTROLLER, LOG_DMA_CHANNEL);
+    prod = ARRAY_SIZE(buffer_rxa_lo) - dma_left;
+    if (prod >= ARRAY_SIZE(buffer_rxa_lo))
+        prod = 0;
+    cons = prod;
+
+    while (1) {
+        if (((polls++ & 0xff) == 0) && (getchar() > 0))
+            break;
+        dma_left = dma_get_number_of_data(LOG_DMA_CONTROLLER,
+                                          LOG_DMA_CHANNEL);
+        prod = ARRAY_SIZE(buffer_rxa_lo) - dma_left;
+        if (prod >= ARRAY_SIZE(buffer_rxa_lo))
+            prod = 0;
+        if (((prod - cons) & (ARRAY_SIZE(buffer_rxa_lo) - 1)) >
+            ARRAY_SIZE(buffer_rxa_lo) - 64) {
+            /* DMA has likely lapped the consumer; skip to current */
+            flags |= SNOOP_FRAME_LOST;
+            cons = prod;
+        }
+
+        while ((cons != prod) && (pos <= SNOOP_FRAME_DATA_MAX - 4)) {
+            uint32_t addr = buffer_rxa_lo[cons] |
+                            ((buffer_rxd[cons] & 0xf0) << (16 - 4));
+            int32_t  delta = (int32_t) (addr - last);
+            uint32_t zz = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+
+            if (pos == 0)
+                flush_time = timer_tick_plus_msec(10);
+            while (zz >= 0x80) {
+                data[pos++] = zz | 0x80;
+                zz >>= 7;
+            }
+            data[pos++] = zz;
+            last = addr;
+            count++;
+            if (++cons >= ARRAY_SIZE(buffer_rxa_lo))
+                cons = 0;
+            if ((max != 0) && (++total >= max))
+                break;
+        }
+
+        if ((max != 0) && (total >= max))
+            break;
+        if ((pos > SNOOP_FRAME_DATA_MAX - 4) ||
+            ((pos != 0) && timer_tick_has_elapsed(flush_time))) {
+            if (snoop_frame_send(frame, pos, count, flags))
+                return;
+            flags &= ~SNOOP_FRAME_LOST;
+            pos   = 0;
+            count = 0;
+        }
+    }
+    (void) snoop_frame_send(frame, pos, count, flags | SNOOP_FRAME_END);
+}
+
 void
 msg_poll(void)
 {
@@ -2268,6 +2389,53 @@ usb_msg_reply(uint flags, uint status, uint rlen1, const void *rbuf1,
     }
 }
 
+/*
+ * usb_msg_receive_batch
+ * ---------------------
+ * Sends to the USB host as many pending Amiga messages as fit within the
+ * host-specified limit, preceded by a smash_msg_batch_t reply describing
+ * them. Returns the number of messages sent.
+ */
+static uint
+usb_msg_receive_batch(uint chan, uint16_t cmd_len, const uint8_t *buf)
+{
+    smash_msg_batch_t reply;
+    msg_queue_t      *mq    = &msg_q_atou[chan];
+    uint              start = mq->mq_cons;
+    uint              limit = mq->mq_size;
+    uint              total = 0;
+    uint              count = 0;
+    uint              len;
+    uint              len1;
+    uint              len2;
+    uint8_t          *buf1;
+    uint8_t          *buf2;
+
+    if (cmd_len >= sizeof (uint16_t))
+        limit = (buf[0] << 8) | buf[1];
+    while ((len = msgq_next_msg_len(mq)) != 0) {
+        if ((count > 0) && (total + len > limit))
+            break;
+        total += len;
+        count++;
+        msgq_consume(mq, len);
+    }
+    mq->mq_cons = start;
+
+    reply.smb_count      = SWAP16(count);
+    reply.smb_bytes      = SWAP16(total);
+    reply.smb_utoa_avail = SWAP16(SPACE_AVAIL(&msg_q_utoa[chan]));
+    reply.smb_unused     = 0;
+    usb_msg_reply(0, KS_STATUS_OK, sizeof (reply), &reply, 0, NULL);
+    if (total == 0)
+        return (0);
+
+    msgq_span(mq, total, &buf1, &len1, &buf2, &len2);
+    usb_msg_reply(KS_REPLY_RAW, 0, len1, buf1, len2, buf2);
+    msgq_consume(mq, total);
+    return (count);
+}
+
 static void
 execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
 {
@@ -2283,38 +2451,7 @@ execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
         case KS_CMD_ID: {
             /* Send KickSmash identification and configuration */
             smash_id_t reply;
-            uint temp[3];
-            int  pos = 0;
-            memset(&reply, 0, sizeof (reply));
-            sscanf(version_str + 8, "%u.%u%n", &temp[0], &temp[1], &pos);
-            reply.si_ks_version[0] = SWAP16(temp[0]);
-            reply.si_ks_version[1] = SWAP16(temp[1]);
-            if (pos == 0)
-                pos = 18;
-            else
-                pos += 8 + 7;
-            sscanf(version_str + pos, "%04u-%02u-%02u",
-                   &temp[0], &temp[1], &temp[2]);
-            reply.si_ks_date[0] = temp[0] / 100;
-            reply.si_ks_date[1] = temp[0] % 100;
-            reply.si_ks_date[2] = temp[1];
-            reply.si_ks_date[3] = temp[2];
-            pos += 11;
-            sscanf(version_str + pos, "%02u:%02u:%02u",
-                   &temp[0], &temp[1], &temp[2]);
-            reply.si_ks_time[0] = temp[0];
-            reply.si_ks_time[1] = temp[1];
-            reply.si_ks_time[2] = temp[2];
-            reply.si_ks_time[3] = 0;
-            strcpy(reply.si_serial, (const char *)usb_serial_str);
-            reply.si_rev      = SWAP16(0x0001);     // Protocol version 0.1
-            reply.si_features = SWAP16(0x0001);     // Features
-            reply.si_usbid    = SWAP32(0x12091610); // Matches USB ID
-            reply.si_mode     = ee_mode;
-            reply.si_unused1  = 0;
-            reply.si_usbdev   = usb_current_address();
-            strcpy(reply.si_name, config.name);
-            memset(reply.si_unused, 0, sizeof (reply.si_unused));
+            smash_id_fill(&reply);
             usb_msg_reply(0, KS_STATUS_OK, sizeof (reply), &reply, 0, NULL);
             break;
         }
@@ -2353,6 +2490,68 @@ execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
             usb_msg_reply(0, KS_STATUS_OK, sizeof (config.bi),
                           &config.bi, 0, NULL);
             break;
+        case KS_CMD_BANK_SNAPSHOT: {
+            /* Get bank info, ID, and NV bytes in a single reply */
+            bank_snapshot_t reply;
+            memcpy(&reply.bs_info, &config.bi, sizeof (reply.bs_info));
+            smash_id_fill(&reply.bs_id);
+            memcpy(reply.bs_nv, config.nv_mem, sizeof (reply.bs_nv));
+            usb_msg_reply(0, KS_STATUS_OK, sizeof (reply), &reply, 0, NULL);
+            break;
+        }
+        case KS_CMD_FLASH_BLANK: {
+            /* Scan flash range for data which is not erased */
+            flash_blank_t reply;
+            uint32_t      args[2];
+            rc_t          rc;
+
+            if (cmd_len != sizeof (args)) {
+                usb_msg_reply(0, KS_STATUS_BADLEN, 0, NULL, 0, NULL);
+                break;
+            }
+            memcpy(args, buf, sizeof (args));
+            rc = prom_blank_check(SWAP32(args[0]), SWAP32(args[1]),
+                                  &reply.fb_first, &reply.fb_sectors,
+                                  &reply.fb_sector_size);
+            if (rc == RC_BUSY) {
+                usb_msg_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
+                break;
+            } else if (rc != RC_SUCCESS) {
+                usb_msg_reply(0, KS_STATUS_FAIL, 0, NULL, 0, NULL);
+                break;
+            }
+            reply.fb_first       = SWAP32(reply.fb_first);
+            reply.fb_sectors     = SWAP32(reply.fb_sectors);
+            reply.fb_sector_size = SWAP32(reply.fb_sector_size);
+            usb_msg_reply(0, KS_STATUS_OK, sizeof (reply), &reply, 0, NULL);
+            break;
+        }
+        case KS_CMD_FLASH_CRC: {
+            /* Compute CRC32 of flash range */
+            uint32_t args[3];
+            uint32_t crc = 0;
+            rc_t     rc;
+
+            if ((cmd_len != sizeof (args)) &&
+                (cmd_len != sizeof (args) - sizeof (crc))) {
+                usb_msg_reply(0, KS_STATUS_BADLEN, 0, NULL, 0, NULL);
+                break;
+            }
+            memcpy(args, buf, cmd_len);
+            if (cmd_len == sizeof (args))
+                crc = SWAP32(args[2]);
+            rc = prom_crc32(SWAP32(args[0]), SWAP32(args[1]), &crc);
+            if (rc == RC_BUSY) {
+                usb_msg_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
+                break;
+            } else if (rc != RC_SUCCESS) {
+                usb_msg_reply(0, KS_STATUS_FAIL, 0, NULL, 0, NULL);
+                break;
+            }
+            crc = SWAP32(crc);
+            usb_msg_reply(0, KS_STATUS_OK, sizeof (crc), &crc, 0, NULL);
+            break;
+        }
         case KS_CMD_MSG_STATE: {
             uint16_t reply[2];
             if (cmd & KS_MSG_STATE_SET) {
@@ -2378,29 +2577,30 @@ execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
         }
         case KS_CMD_MSG_INFO: {
             smash_msg_info_t reply;
+            uint             chan = KS_MSG_CHAN_GET(cmd);
             uint16_t         avail_atou;
             uint16_t         avail_utoa;
             uint16_t         inuse_atou;
             uint16_t         inuse_utoa;
 
-            if (msg_lock & BIT(0)) {
+            if (msg_lock[chan] & BIT(0)) {
                 inuse_atou = 0;
                 avail_atou = 0;
             } else {
-                inuse_atou = SPACE_INUSE_ATOU;
-                avail_atou = SPACE_AVAIL_ATOU;
+                inuse_atou = SPACE_INUSE(&msg_q_atou[chan]);
+                avail_atou = SPACE_AVAIL(&msg_q_atou[chan]);
                 if (avail_atou >= KS_HDR_AND_CRC_LEN)
                     avail_atou -= KS_HDR_AND_CRC_LEN;
                 else
                     avail_atou = 0;
             }
 
-            if (msg_lock & BIT(1)) {
+            if (msg_lock[chan] & BIT(1)) {
                 inuse_utoa = 0;
                 avail_utoa = 0;
             } else {
-                inuse_utoa = SPACE_INUSE_UTOA;
-                avail_utoa = SPACE_AVAIL_UTOA;
+                inuse_utoa = SPACE_INUSE(&msg_q_utoa[chan]);
+                avail_utoa = SPACE_AVAIL(&msg_q_utoa[chan]);
                 if (avail_utoa >= KS_HDR_AND_CRC_LEN)
                     avail_utoa -= KS_HDR_AND_CRC_LEN;
                 else
@@ -2425,17 +2625,23 @@ execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
         case KS_CMD_MSG_SEND: {
             uint64_t new_expire;
             uint raw_len = cmd_len + KS_HDR_AND_CRC_LEN;  // Magic+len+cmd+CRC
+            uint chan = KS_MSG_CHAN_GET(cmd);
             uint rc;
 
-            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock & BIT(1))) ||
-                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock & BIT(0)))) {
+            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock[chan] & BIT(1))) ||
+                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock[chan] & BIT(0)))) {
                 usb_msg_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                 break;
             }
-            if ((cmd & KS_MSG_ALTBUF) == 0)
-                rc = utoa_add(raw_len, rawbuf);
-            else
-                rc = atou_add(raw_len, rawbuf);
+            if ((cmd & KS_MSG_ALTBUF) == 0) {
+                rc = msgq_add(&msg_q_utoa[chan], raw_len, rawbuf);
+                if (rc == 0)
+                    messages_utoa++;
+            } else {
+                rc = msgq_add(&msg_q_atou[chan], raw_len, rawbuf);
+                if (rc == 0)
+                    messages_atou++;
+            }
 
             if (rc != 0)
                 usb_msg_reply(0, KS_STATUS_BADLEN, 0, NULL, 0, NULL);
@@ -2449,56 +2655,51 @@ execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
             break;
         }
         case KS_CMD_MSG_RECEIVE: {
-            uint64_t new_expire;
-            uint     len;
-            uint     len1;
-            uint     len2;
-            uint8_t *buf1;
-            uint8_t *buf2;
-
-            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock & BIT(0))) ||
-                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock & BIT(1)))) {
+            uint64_t     new_expire;
+            uint         chan = KS_MSG_CHAN_GET(cmd);
+            msg_queue_t *mq;
+            uint         len;
+            uint         len1;
+            uint         len2;
+            uint8_t     *buf1;
+            uint8_t     *buf2;
+            uint         sent = 0;
+
+            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock[chan] & BIT(0))) ||
+                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock[chan] & BIT(1)))) {
                 usb_msg_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                 break;
             }
 
-            if ((cmd & KS_MSG_ALTBUF) == 0) {
-                len = atou_next_msg_len();
-                len1 = sizeof (msg_atou) - cons_atou;
-                if (len1 > len) {
-                    /* Send data doesn't wrap */
-                    len1 = len;
-                    len2 = 0;
-                } else {
-                    /* Send data from end + beginning of circular buffer */
-                    len2 = len - len1;
-                }
-                buf1 = msg_atou + cons_atou;
-                buf2 = msg_atou;
+            if ((cmd & KS_MSG_ALTBUF) == 0)
+                mq = &msg_q_atou[chan];
+            else
+                mq = &msg_q_utoa[chan];
+
+            if ((cmd & (KS_MSG_RX_BATCH | KS_MSG_ALTBUF)) == KS_MSG_RX_BATCH) {
+                /* Send as many pending messages as fit, in one reply */
+                sent = usb_msg_receive_batch(chan, cmd_len, buf);
             } else {
-                len = utoa_next_msg_len();
-                len1 = sizeof (msg_utoa) - cons_utoa;
-                if (len1 > len) {
-                    /* Send data doesn't wrap */
-                    len1 = len;
-                    len2 = 0;
-                } else {
-                    /* Send data from end + beginning of circular buffer */
-                    len2 = len - len1;
-                }
-                buf1 = msg_utoa + cons_utoa;
-                buf2 = msg_utoa;
-            }
-            if (len == 0) {
-                usb_msg_reply(0, KS_STATUS_NODATA, 0, NULL, 0, NULL);
-                break;
+                /*
+                 * With KS_MSG_RX_ALL, every pending message is sent,
+                 * followed by a KS_STATUS_NODATA reply to mark the end.
+                 */
+                do {
+                    len = msgq_next_msg_len(mq);
+                    if (len == 0) {
+                        usb_msg_reply(0, KS_STATUS_NODATA, 0, NULL, 0, NULL);
+                        break;
+                    }
+
+                    msgq_span(mq, len, &buf1, &len1, &buf2, &len2);
+                    usb_msg_reply(KS_REPLY_RAW, 0, len1, buf1, len2, buf2);
+                    msgq_consume(mq, len);
+                    sent++;
+                } while (cmd & KS_MSG_RX_ALL);
             }
 
-            usb_msg_reply(KS_REPLY_RAW, 0, len1, buf1, len2, buf2);
-            if ((cmd & KS_MSG_ALTBUF) == 0)
-                cons_atou = (cons_atou + len) & (sizeof (msg_atou) - 1);
-            else
-                cons_utoa = (cons_utoa + len) & (sizeof (msg_utoa) - 1);
+            if (sent == 0)
+                break;
 
             /* Extend state expiration when transfer in progress */
             new_expire = timer_tick_plus_msec(1000);
@@ -2507,34 +2708,37 @@ execute_usb_cmd(uint16_t cmd, uint16_t cmd_len, uint8_t *rawbuf)
             break;
         }
         case KS_CMD_MSG_LOCK: {
+            uint chan = KS_MSG_CHAN_GET(cmd);
             uint lockbits = (buf[0] << 8) | buf[1];
 
             if (cmd & KS_MSG_UNLOCK) {
-                msg_lock &= ~lockbits;
+                msg_lock[chan] &= ~lockbits;
             } else {
-                if (((lockbits & BIT(2)) && (msg_lock & BIT(0))) ||
-                    ((lockbits & BIT(3)) && (msg_lock & BIT(1)))) {
+                if (((lockbits & BIT(2)) && (msg_lock[chan] & BIT(0))) ||
+                    ((lockbits & BIT(3)) && (msg_lock[chan] & BIT(1)))) {
                     /* Attempted to lock resource owned by the other side */
                     usb_msg_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                     break;
                 }
-                msg_lock |= lockbits;
+                msg_lock[chan] |= lockbits;
             }
             usb_msg_reply(0, KS_STATUS_OK, 0, NULL, 0, NULL);
             break;
         }
-        case KS_CMD_MSG_FLUSH:
-            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock & BIT(0))) ||
-                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock & BIT(1)))) {
+        case KS_CMD_MSG_FLUSH: {
+            uint chan = KS_MSG_CHAN_GET(cmd);
+            if ((((cmd & KS_MSG_ALTBUF) == 0) && (msg_lock[chan] & BIT(0))) ||
+                (((cmd & KS_MSG_ALTBUF) != 0) && (msg_lock[chan] & BIT(1)))) {
                 usb_msg_reply(0, KS_STATUS_LOCKED, 0, NULL, 0, NULL);
                 break;
             }
             if ((cmd & KS_MSG_ALTBUF) == 0)
-                cons_atou = prod_atou;  // default: flush "my" receive buffer
+                msgq_flush(&msg_q_atou[chan]);  // default: "my" receive buffer
             else
-                cons_utoa = prod_utoa;
+                msgq_flush(&msg_q_utoa[chan]);
             usb_msg_reply(0, KS_STATUS_OK, 0, NULL, 0, NULL);
             break;
+        }
         case KS_CMD_CLOCK: {
             uint64_t  now  = timer_tick_get();
             uint64_t  usec = timer_tick_to_usec(now);
@@ -2591,7 +2795,13 @@ msg_usb_service(void)
             /* Timeout will clobber received data and reset */
             uint64_t timeout = timer_tick_plus_msec(200);
             while ((int)(ch = getchar()) == -1) {
-                main_poll();
+                /*
+                 * USB data is received by the USB interrupt. Once a
+                 * frame has started, the rest is imminent, so don't let
+                 * a slow main_poll() pass delay its processing.
+                 */
+                if (pos == 0)
+                    main_poll();
                 if (timer_tick_has_elapsed(timeout)) {
                     pos = 0;
                     break;
@@ -2691,6 +2901,8 @@ msg_shutdown(void)
 void
 msg_init(void)
 {
+    uint chan;
+
     /*
      * Configure DMA on SOCKET_OE going low
      *
@@ -2784,6 +2996,18 @@ msg_init(void)
     nvic_set_priority(LOG_DMA_NVIC_IRQ, 0x20);
     nvic_enable_irq(LOG_DMA_NVIC_IRQ);
 
+    /* Channel 0 keeps the original 4K buffers; other channels are smaller */
+    msg_q_atou[0].mq_buf  = msg_atou;
+    msg_q_atou[0].mq_size = sizeof (msg_atou);
+    msg_q_utoa[0].mq_buf  = msg_utoa;
+    msg_q_utoa[0].mq_size = sizeof (msg_utoa);
+    for (chan = 1; chan < KS_MSG_CHANNELS; chan++) {
+        msg_q_atou[chan].mq_buf  = msg_chan_atou[chan - 1];
+        msg_q_atou[chan].mq_size = sizeof (msg_chan_atou[0]);
+        msg_q_utoa[chan].mq_buf  = msg_chan_utoa[chan - 1];
+        msg_q_utoa[chan].mq_size = sizeof (msg_chan_utoa[0]);
+    }
+
     capture_mode = CAPTURE_ADDR;
     configure_oe_capture_rx(true);
 }
@@ -14,6 +14,7 @@
 
 int      address_log_replay(uint max);
 void     bus_snoop(uint mode);
+void     bus_snoop_stream(uint max);
 void     msg_poll(void);
 void     msg_init(void);
 void     msg_shutdown(void);
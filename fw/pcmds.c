@@ -68,10 +68,12 @@ const char cmd_prom_help[] =
 "prom log [<count>]      - show log of Amiga address accesses\n"
 "prom mode 0|1|2|3       - set EEPROM access mode (0=32, 1=16lo, 2=16hi)\n"
 "prom name [<name>]      - set or show name of this board\n"
-"prom read <addr> <len>  - read binary data from EEPROM (to terminal)\n"
+"prom read <addr> <len> [<chunk> <window>]\n"
+"                        - read binary data from EEPROM (to terminal)\n"
 "prom service            - enter Amiga/USB message service mode\n"
 "prom temp               - show STM32 die temperature\n"
-"prom write <addr> <len> - write binary data to EEPROM (from terminal)\n"
+"prom write <addr> <len> [<copies> <stride>]\n"
+"                        - write binary data to EEPROM (from terminal)\n"
 "prom test               - test pins (standalone board only)";
 
 const char cmd_reset_help[] =
@@ -92,7 +94,8 @@ const char cmd_snoop_help[] =
 "snoop        - capture and report ROM transactions\n"
 "snoop addr   - hardware capture A0-A19\n"
 "snoop lo     - hardware capture A0-A15 D0-D15\n"
-"snoop hi     - hardware capture A0-A15 D16-D31";
+"snoop hi     - hardware capture A0-A15 D16-D31\n"
+"snoop stream [<count>] - binary address stream to host (hostsmash -P)";
 
 const char cmd_usb_help[] =
 "usb disable - reset and disable USB\n"
@@ -564,20 +567,42 @@ cmd_prom(int argc, char * const *argv)
     }
 
     switch (op_mode) {
-        case OP_READ:
-            if (argc != 3) {
-                printf("error: prom %s requires <addr> and <len>\n", arg);
+        case OP_READ: {
+            uint32_t chunk = 0;
+            uint32_t window = 0;
+            if ((argc != 3) && (argc != 5)) {
+                printf("error: prom %s requires <addr> and <len>, "
+                       "and optional <chunk> <window>\n", arg);
                 return (RC_USER_HELP);
             }
-            rc = prom_read_binary(addr, len);
+            if (argc == 5) {
+                rc = parse_value(argv[3], (uint8_t *) &chunk, 4);
+                if (rc == RC_SUCCESS)
+                    rc = parse_value(argv[4], (uint8_t *) &window, 4);
+                if (rc != RC_SUCCESS)
+                    return (rc);
+            }
+            rc = prom_read_binary(addr, len, chunk, window);
             break;
-        case OP_WRITE:
-            if (argc != 3) {
-                printf("error: prom %s requires <addr> and <len>\n", arg);
+        }
+        case OP_WRITE: {
+            uint32_t copies = 0;
+            uint32_t stride = 0;
+            if ((argc != 3) && (argc != 5)) {
+                printf("error: prom %s requires <addr> and <len>, "
+                       "and optional <copies> <stride>\n", arg);
                 return (RC_USER_HELP);
             }
-            rc = prom_write_binary(addr, len);
+            if (argc == 5) {
+                rc = parse_value(argv[3], (uint8_t *) &copies, 4);
+                if (rc == RC_SUCCESS)
+                    rc = parse_value(argv[4], (uint8_t *) &stride, 4);
+                if (rc != RC_SUCCESS)
+                    return (rc);
+            }
+            rc = prom_write_binary(addr, len, copies, stride);
             break;
+        }
         case OP_ERASE_CHIP:
             printf("Chip erase\n");
             if (argc != 1) {
@@ -889,6 +914,15 @@ cmd_snoop(int argc, char * const *argv)
             mode = CAPTURE_DATA_LO;
         } else if (strncmp(argv[1], "high", 2) == 0) {
             mode = CAPTURE_DATA_HI;
+        } else if (strcmp(argv[1], "stream") == 0) {
+            uint max = 0;
+            if (argc > 2) {
+                rc_t rc = parse_value(argv[2], (uint8_t *) &max, 4);
+                if (rc != RC_SUCCESS)
+                    return (rc);
+            }
+            bus_snoop_stream(max);
+            return (RC_SUCCESS);
         } else {
             printf("snoop \"%s\" unknown argument\n", argv[1]);
             return (RC_USER_HELP);
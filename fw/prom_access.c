@@ -24,7 +24,10 @@
 #include "led.h"
 #include "gpio.h"
 
-#define DATA_CRC_INTERVAL 256
+#define DATA_CRC_INTERVAL    256
+#define PROM_READ_CHUNK_MAX  1024  // Largest negotiated read chunk
+#define PROM_READ_WINDOW_MAX 16    // Most chunks awaiting host status
+#define PROM_WRITE_COPIES_MAX 32   // Most locations written from one stream
 
 static int
 warn_amiga_not_in_reset(void)
@@ -246,6 +249,108 @@ prom_erase(uint mode, uint32_t addr, uint32_t len)
     return (rc);
 }
 
+/*
+ * prom_blank_check
+ * ----------------
+ * Scans the specified range of flash for non-erased data. The address and
+ * length are in bytes of the current flash mode. On return, <first> holds
+ * the offset from <addr> of the first non-blank word (0xffffffff if the
+ * entire range is blank), and <sectors> holds the number of erase sectors
+ * touched by the range which contain data. Once a sector is found to
+ * contain data, the remainder of that sector is skipped.
+ */
+rc_t
+prom_blank_check(uint32_t addr, uint32_t len, uint32_t *first,
+                 uint32_t *sectors, uint32_t *sector_size)
+{
+    uint32_t words[64];
+    uint32_t waddr;
+    uint32_t wend;
+    uint32_t sector_words = MX_ERASE_SECTOR_SIZE;
+    uint     shift;
+
+    if (warn_amiga_not_in_reset())
+        return (RC_BUSY);
+
+    if ((ee_mode == EE_MODE_32) || (ee_mode == EE_MODE_32_SWAP))
+        shift = 2;
+    else
+        shift = 1;
+
+    *first       = 0xffffffff;
+    *sectors     = 0;
+    *sector_size = sector_words << shift;
+
+    waddr = addr >> shift;
+    wend  = (addr + len + (1 << shift) - 1) >> shift;
+
+    ee_enable();
+    while (waddr < wend) {
+        uint32_t sector_end = (waddr | (sector_words - 1)) + 1;
+        uint     count;
+        uint     pos;
+
+        if (sector_end > wend)
+            sector_end = wend;
+        count = sector_end - waddr;
+        if (count > (sizeof (words) >> shift))
+            count = sizeof (words) >> shift;
+
+        /* Odd 16-bit word count leaves the tail of the last entry blank */
+        memset(words, 0xff, sizeof (words));
+        if (ee_read(waddr, words, count))
+            return (RC_FAILURE);
+
+        for (pos = 0; pos < count << shift; pos += 4)
+            if (words[pos / 4] != 0xffffffff)
+                break;
+
+        if (pos < count << shift) {
+            if (*first == 0xffffffff) {
+                uint32_t offset;
+                if ((shift == 1) && (((uint16_t *) words)[pos / 2] == 0xffff))
+                    pos += 2;  // Data is in the second 16-bit word
+                offset = (waddr << shift) + pos;
+                *first = (offset > addr) ? (offset - addr) : 0;
+            }
+            (*sectors)++;
+            waddr = (waddr | (sector_words - 1)) + 1;  // Skip rest of sector
+        } else {
+            waddr += count;
+        }
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * prom_crc32
+ * ----------
+ * Computes the CRC32 of the specified range of flash, continuing from
+ * the value in *crcp. The address and length are in bytes of the current
+ * flash mode.
+ */
+rc_t
+prom_crc32(uint32_t addr, uint32_t len, uint32_t *crcp)
+{
+    uint32_t words[64];
+    uint32_t crc = *crcp;
+    rc_t     rc;
+
+    while (len > 0) {
+        uint tlen = sizeof (words);
+        if (tlen > len)
+            tlen = len;
+        rc = prom_read(addr, tlen, words);
+        if (rc != RC_SUCCESS)
+            return (rc);
+        crc   = crc32(crc, words, tlen);
+        addr += tlen;
+        len  -= tlen;
+    }
+    *crcp = crc;
+    return (RC_SUCCESS);
+}
+
 void
 prom_cmd(uint32_t addr, uint32_t cmd)
 {
@@ -336,18 +441,23 @@ check_rc(uint pos)
 
 /*
  * prom_read_binary() reads data from an EEPROM and writes it to the host.
- *                    Every 256 bytes, a rolling CRC value is expected back
- *                    from the host.
+ *                    Every chunk (256 bytes by default), a rolling CRC value
+ *                    is sent and a status byte is expected back from the
+ *                    host. Up to <window> chunks may be outstanding before
+ *                    the host's status is required. If <chunk> is non-zero,
+ *                    the host has requested a chunk size and window; the
+ *                    accepted (possibly reduced) values are sent to the host
+ *                    first, as two 16-bit values.
  */
 rc_t
-prom_read_binary(uint32_t addr, uint32_t len)
+prom_read_binary(uint32_t addr, uint32_t len, uint chunk, uint window)
 {
     rc_t     rc;
-    __attribute__((aligned(16)))
-    uint8_t  buf[256];
+    static __attribute__((aligned(16)))
+    uint8_t  buf[PROM_READ_CHUNK_MAX];
     uint32_t crc = 0;
-    uint     crc_next = DATA_CRC_INTERVAL;
-    uint32_t cap_pos[4];
+    uint     crc_next;
+    uint32_t cap_pos[PROM_READ_WINDOW_MAX];
     uint     cap_count = 0;
     uint     cap_prod  = 0;  // producer
     uint     cap_cons  = 0;  // consumer
@@ -356,9 +466,31 @@ prom_read_binary(uint32_t addr, uint32_t len)
     if (warn_amiga_not_in_reset())
         return (RC_BUSY);
 
+    if (chunk == 0) {
+        /* Original protocol */
+        chunk  = DATA_CRC_INTERVAL;
+        window = 4;
+    } else {
+        uint16_t accepted[2];
+        chunk &= ~3;
+        if (chunk < 4)
+            chunk = 4;
+        if (chunk > PROM_READ_CHUNK_MAX)
+            chunk = PROM_READ_CHUNK_MAX;
+        if (window < 1)
+            window = 1;
+        if (window > PROM_READ_WINDOW_MAX)
+            window = PROM_READ_WINDOW_MAX;
+        accepted[0] = chunk;
+        accepted[1] = window;
+        if (puts_binary(accepted, sizeof (accepted)))
+            return (RC_TIMEOUT);
+    }
+    crc_next = chunk;
+
     ee_enable();
     while (len > 0) {
-        uint32_t tlen = sizeof (buf);
+        uint32_t tlen = chunk;
         if (tlen > len)
             tlen = len;
         if (tlen > crc_next)
@@ -381,12 +513,12 @@ prom_read_binary(uint32_t addr, uint32_t len)
         len      -= tlen;
         pos      += tlen;
 
-        if (cap_count >= ARRAY_SIZE(cap_pos)) {
+        if (cap_count >= window) {
             /* Verify received RC */
             cap_count--;
             if (check_rc(cap_pos[cap_cons]))
                 return (RC_FAILURE);
-            if (++cap_cons >= ARRAY_SIZE(cap_pos))
+            if (++cap_cons >= window)
                 cap_cons = 0;
         }
 
@@ -397,32 +529,28 @@ prom_read_binary(uint32_t addr, uint32_t len)
                 return (RC_TIMEOUT);
             }
             cap_pos[cap_prod] = pos;
-            if (++cap_prod >= ARRAY_SIZE(cap_pos))
+            if (++cap_prod >= window)
                 cap_prod = 0;
             cap_count++;
-            crc_next = DATA_CRC_INTERVAL;
+            crc_next = chunk;
         }
         led_poll();  // Blink power LED if it needs to be blinked
     }
-    if (crc_next != DATA_CRC_INTERVAL) {
+    if (crc_next != chunk) {
         /* Send CRC for last partial segment */
         if (puts_binary(&crc, sizeof (crc)))
             return (RC_TIMEOUT);
     }
 
     /* Verify trailing CRC packets */
-    cap_prod += ARRAY_SIZE(cap_pos) - cap_count;
-    if (cap_prod >= ARRAY_SIZE(cap_pos))
-        cap_prod -= ARRAY_SIZE(cap_pos);
-
     while (cap_count-- > 0) {
         if (check_rc(cap_pos[cap_cons]))
             return (1);
-        if (++cap_cons >= ARRAY_SIZE(cap_pos))
+        if (++cap_cons >= window)
             cap_cons = 0;
     }
 
-    if (crc_next != DATA_CRC_INTERVAL) {
+    if (crc_next != chunk) {
         /* Verify CRC for last partial segment */
         if (check_rc(pos))
             return (RC_FAILURE);
@@ -436,10 +564,13 @@ prom_read_binary(uint32_t addr, uint32_t len)
  *                     a rolling 8-bit CRC value is sent back to the host.
  *                     This is so the host knows that the data was received
  *                     correctly. Incorrectly received data will still be
- *                     written to the EEPROM.
+ *                     written to the EEPROM. If <copies> is non-zero, the
+ *                     data is written to that many locations, <stride> bytes
+ *                     apart, as it is received. The accepted copies and
+ *                     stride are first sent to the host as two 32-bit values.
  */
 rc_t
-prom_write_binary(uint32_t addr, uint32_t len)
+prom_write_binary(uint32_t addr, uint32_t len, uint copies, uint32_t stride)
 {
     uint8_t  buf[128];
     int      ch;
@@ -447,10 +578,27 @@ prom_write_binary(uint32_t addr, uint32_t len)
     uint32_t crc = 0;
     uint32_t saddr = addr;
     uint     crc_next = DATA_CRC_INTERVAL;
+    uint     copy;
 
     if (warn_amiga_not_in_reset())
         return (RC_BUSY);
 
+    if (copies == 0) {
+        /* Original protocol */
+        copies = 1;
+    } else {
+        uint32_t accepted[2];
+        if ((copies > PROM_WRITE_COPIES_MAX) || (stride < len) ||
+            (stride & (sizeof (buf) - 1))) {
+            printf("error: invalid copies %u or stride %lx\n", copies, stride);
+            return (RC_BAD_PARAM);
+        }
+        accepted[0] = copies;
+        accepted[1] = stride;
+        if (puts_binary(accepted, sizeof (accepted)))
+            return (RC_TIMEOUT);
+    }
+
     ee_enable();
     while (len > 0) {
         uint32_t tlen    = len;
@@ -486,7 +634,11 @@ prom_write_binary(uint32_t addr, uint32_t len)
                 saddr = addr + pos + 1;
             }
         }
-        rc = prom_write(addr, tlen, buf);
+        for (copy = 0; copy < copies; copy++) {
+            rc = prom_write(addr + copy * stride, tlen, buf);
+            if (rc != RC_SUCCESS)
+                break;
+        }
         if (rc != RC_SUCCESS) {
 fail:
             (void) puts_binary(&rc, 1);  // Inform remote side
@@ -15,8 +15,12 @@
 rc_t prom_read(uint32_t addr, uint width, void *bufp);
 rc_t prom_write(uint32_t addr, uint width, void *bufp);
 rc_t prom_erase(uint mode, uint32_t addr, uint32_t len);
-rc_t prom_read_binary(uint32_t addr, uint32_t len);
-rc_t prom_write_binary(uint32_t addr, uint32_t len);
+rc_t prom_read_binary(uint32_t addr, uint32_t len, uint chunk, uint window);
+rc_t prom_write_binary(uint32_t addr, uint32_t len, uint copies,
+                       uint32_t stride);
+rc_t prom_blank_check(uint32_t addr, uint32_t len, uint32_t *first,
+                      uint32_t *sectors, uint32_t *sector_size);
+rc_t prom_crc32(uint32_t addr, uint32_t len, uint32_t *crcp);
 void prom_cmd(uint32_t addr, uint32_t cmd);
 rc_t prom_id(void);
 rc_t prom_status(void);
@@ -28,11 +28,14 @@
 #define KS_CMD_FLASH_ERASE   0x13  // Generate flash erase sequence
 #define KS_CMD_FLASH_WRITE   0x14  // Generate flash write sequence
 #define KS_CMD_FLASH_MWRITE  0x15  // Flash write multiple (not implemented)
+#define KS_CMD_FLASH_BLANK   0x16  // Check that a flash range is erased
+#define KS_CMD_FLASH_CRC     0x17  // Compute CRC32 of a flash range
 #define KS_CMD_BANK_INFO     0x20  // Get ROM bank information structure
 #define KS_CMD_BANK_SET      0x21  // Set bank (options in high bits)
 #define KS_CMD_BANK_MERGE    0x22  // Merge or unmerge banks
 #define KS_CMD_BANK_NAME     0x23  // Set a bank name
 #define KS_CMD_BANK_LRESET   0x24  // Set bank longreset sequence
+#define KS_CMD_BANK_SNAPSHOT 0x25  // Get bank info, ID, and NV in one reply
 #define KS_CMD_MSG_STATE     0x30  // Application state (for remote message)
 #define KS_CMD_MSG_INFO      0x31  // Query message queue sizes
 #define KS_CMD_MSG_SEND      0x32  // Send a remote message
@@ -68,6 +71,12 @@
 #define KS_BANK_UNMERGE    0x0100  // Unmerge bank range (KS_BANK_MERGE)
 
 #define KS_MSG_ALTBUF      0x0100  // Perform operations on alternate buffer
+#define KS_MSG_RX_ALL      0x0200  // Receive all pending messages
+#define KS_MSG_RX_BATCH    0x0400  // Receive pending messages in one reply
+#define KS_MSG_CHAN_MASK   0x3000  // Message channel (see KS_MSG_CHANNEL())
+#define KS_MSG_CHANNELS    4       // Number of message channels
+#define KS_MSG_CHANNEL(x)  (((x) << 12) & KS_MSG_CHAN_MASK)
+#define KS_MSG_CHAN_GET(c) (((c) & KS_MSG_CHAN_MASK) >> 12)
 
 #define KS_MSG_UNLOCK      0x0100  // Unlock instead of lock
 
@@ -78,10 +87,17 @@
 
 #define KS_HDR_AND_CRC_LEN (8 + 2 + 2 + 4)  // Magic+Len+Cmd+CRC = 16 bytes
 
+/* smash_id_t si_features bits */
+#define KS_FEATURE_BASE         0x0001  // Original command set
+#define KS_FEATURE_MSG_RX_ALL   0x0002  // KS_CMD_MSG_RECEIVE KS_MSG_RX_ALL
+#define KS_FEATURE_MSG_RX_BATCH 0x0004  // KS_CMD_MSG_RECEIVE KS_MSG_RX_BATCH
+#define KS_FEATURE_MSG_CHANNELS 0x0008  // KS_CMD_MSG_* KS_MSG_CHANNEL(x)
+
 /* Application state bits */
 #define MSG_STATE_SERVICE_UP    0x0001  // Message service running
 #define MSG_STATE_HAVE_LOOPBACK 0x0002  // Loopback service available
 #define MSG_STATE_HAVE_FILE     0x0004  // File service available
+#define MSG_STATE_HAVE_CHANNELS 0x0008  // All message channels serviced
 
 /*
  * All Kicksmash commands are encapsulated within a standard message body
@@ -199,6 +215,24 @@
  *   KS_CMD_FLASH_MWRITE
  *        This command will set up a multiple data write sequence for the
  *        flash. It is not currently implemented.
+ *   KS_CMD_FLASH_BLANK
+ *        The Kicksmash will scan a range of flash and report whether it
+ *        is erased. Two 32-bit big endian values are sent: the starting
+ *        address and length in bytes, in the address space of the current
+ *        flash mode (as used by the "prom" commands). A structure,
+ *        flash_blank_t, is returned which holds the offset of the first
+ *        non-blank byte (0xffffffff if all blank), the count of sectors
+ *        which are not blank, and the sector size. This command is only
+ *        available over USB and requires the Amiga to be held in reset.
+ *   KS_CMD_FLASH_CRC
+ *        The Kicksmash will compute the CRC32 (same as crc32() in crc32.c)
+ *        of a range of flash. Two 32-bit big endian values are sent: the
+ *        starting address and length in bytes, in the address space of
+ *        the current flash mode. An optional third value is the starting
+ *        CRC (default 0), which allows a large range to be computed in
+ *        pieces. The 32-bit big endian CRC is returned. Data is read in
+ *        raw flash order (no byte swapping). This command is only
+ *        available over USB and requires the Amiga to be held in reset.
  *   KS_CMD_GET
  *        Get Kicksmash value. The following option must be specified with
  *            KS_GET_NV - Get non-volatile byte(s). The following byte
@@ -253,6 +287,12 @@
  *        This command is used to specify the long reset sequence. Up to
  *        8 banks may be specified in the sequence, and the command length
  *        is always 8 bytes. Unused bank numbers must be set to 0xff values.
+ *   KS_CMD_BANK_SNAPSHOT
+ *        A structure, bank_snapshot_t, is returned which holds everything
+ *        a ROM bank switcher needs to display its initial state: the
+ *        bank_info_t of KS_CMD_BANK_INFO, the smash_id_t of KS_CMD_ID, and
+ *        all non-volatile bytes of KS_CMD_GET KS_GET_NV. This avoids the
+ *        cost of several separate ROM message round trips.
  *   KS_CMD_MSG_STATE
  *        Get application state information which is shared between Amiga
  *        and USB. Each is a 16-bit value:
@@ -285,6 +325,16 @@
  *        If there is data pending from the USB host, it will be returned to
  *        the Amiga in the buffer, given there is sufficient space available.
  *        See below for payload format.
+ *        From the USB host, add the KS_MSG_RX_ALL flag to receive every
+ *        pending message, one reply per message, followed by a reply with
+ *        KS_STATUS_NODATA. Firmware supporting this sets the
+ *        KS_FEATURE_MSG_RX_ALL bit in si_features.
+ *        Alternatively, add the KS_MSG_RX_BATCH flag and an optional 16-bit
+ *        big endian byte limit (default is the buffer size). A
+ *        smash_msg_batch_t reply is sent first, then a single reply holding
+ *        smb_count consecutive messages (smb_bytes total). At least one
+ *        message is sent if any is pending. Firmware supporting this sets
+ *        the KS_FEATURE_MSG_RX_BATCH bit in si_features.
  *   KS_CMD_MSG_LOCK
  *        A single value is specified, which are the lock bits:
  *              bit 0 = lock buffer 1 from Amiga access
@@ -298,6 +348,16 @@
  *        is the USB-to-Amiga buffer. If KS_MSG_ALTBUF is specified, then the
  *        opposite-direction buffer will be flushed.
  *
+ * Message buffers are grouped in KS_MSG_CHANNELS independent channels,
+ * each with its own pair of buffers and lock bits. KS_MSG_CHANNEL(x) in
+ * the command code of KS_CMD_MSG_INFO, KS_CMD_MSG_SEND, KS_CMD_MSG_RECEIVE,
+ * KS_CMD_MSG_LOCK, or KS_CMD_MSG_FLUSH selects the channel. Channel 0 is
+ * the default, with 4 KB buffers; other channels have 2 KB buffers. A
+ * message keeps the channel bits of the KS_CMD_MSG_SEND which sent it,
+ * so they must be masked from the receive status. Firmware supporting
+ * channels sets the KS_FEATURE_MSG_CHANNELS bit in si_features. Older
+ * firmware ignores the channel bits, using channel 0 for everything.
+ *
  * The payload of KS_CMD_MSG_SEND is normal byte order on the Amiga side,
  * but is byte-swapped when the USB host is dealing with the data. This is
  * an artifact of how the STM32 DMA works with GPIO ports. The USB host is
@@ -337,6 +397,18 @@ typedef struct {
     uint8_t  si_unused[24];              // Unused space
 } smash_id_t;
 
+typedef struct {
+    bank_info_t bs_info;                 // Same as KS_CMD_BANK_INFO
+    smash_id_t  bs_id;                   // Same as KS_CMD_ID
+    uint8_t     bs_nv[32];               // Same as KS_CMD_GET KS_GET_NV
+} bank_snapshot_t;
+
+typedef struct {
+    uint32_t fb_first;                   // Offset of first non-blank data
+    uint32_t fb_sectors;                 // Count of non-blank sectors
+    uint32_t fb_sector_size;             // Flash sector size in bytes
+} flash_blank_t;
+
 typedef struct {
     uint16_t smi_atou_inuse;             // Amiga -> USB buffer bytes in use
     uint16_t smi_atou_avail;             // Amiga -> USB buffer bytes free
@@ -347,6 +419,33 @@ typedef struct {
     uint8_t  smi_unused[16];             // Unused space
 } smash_msg_info_t;
 
+typedef struct {
+    uint16_t smb_count;                  // Number of messages which follow
+    uint16_t smb_bytes;                  // Total length of those messages
+    uint16_t smb_utoa_avail;             // USB -> Amiga buffer bytes free
+    uint16_t smb_unused;                 // Unused space
+} smash_msg_batch_t;
+
+/*
+ * Binary frame of ROM fetch addresses sent by the "snoop stream" command.
+ * Each address is a ROM word address (A0-A19) encoded as the zigzag
+ * varint delta from the previous address, carried across frames.
+ * Fields are in STM32 (little endian) byte order.
+ */
+#define SNOOP_FRAME_MAGIC     0x5e0f
+#define SNOOP_FRAME_DATA_MAX  496     // Maximum encoded bytes in a frame
+#define SNOOP_FRAME_32BIT     0x0001  // ROM is 32-bit (Amiga addr = A << 2)
+#define SNOOP_FRAME_LOST      0x0002  // Captures were lost before this frame
+#define SNOOP_FRAME_END       0x0004  // Final frame of the stream
+
+typedef struct {
+    uint16_t sf_magic;                   // SNOOP_FRAME_MAGIC
+    uint16_t sf_flags;                   // SNOOP_FRAME_* flags
+    uint16_t sf_len;                     // Encoded bytes which follow
+    uint16_t sf_count;                   // Addresses encoded in this frame
+    uint32_t sf_crc;                     // CRC32 of the encoded bytes
+} snoop_frame_t;
+
 typedef struct {
     uint8_t  km_op;        // Operation to perform (KM_OP_*)
     uint8_t  km_status;    // Status reply
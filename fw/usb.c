@@ -867,6 +867,9 @@ usb_show_stats(void)
     printf("packet drops=%u\n", usb_drop_packets);
     printf("byte drops=%u\n", usb_drop_bytes);
     printf("send timeouts=%u\n", usb_send_timeouts);
+    printf("poll loop max=%u usec\n",
+           (uint) timer_tick_to_usec(main_poll_max_ticks));
+    main_poll_max_ticks = 0;
 }
 
 uint16_t
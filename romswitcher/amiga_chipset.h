@@ -44,6 +44,8 @@
 #define INTENA    VADDR16(0x00dff09a)  // Interrupt enable register (write)
 #define INTREQR   VADDR16(0x00dff01e)  // Interrupt status register (read)
 #define INTREQ    VADDR16(0x00dff09c)  // Interrupt status register (write)
+#define COP1LC    VADDR32(0x00dff080)  // Copper first location register
+#define COPJMP1   VADDR16(0x00dff088)  // Copper restart at first location
 #define DIWSTRT   VADDR16(0x00dff08e)  // Start of screen window
 #define DIWSTOP   VADDR16(0x00dff090)  // End of screen window
 #define DDFSTRT   VADDR16(0x00dff092)  // Bitplane DMA start
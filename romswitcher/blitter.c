@@ -26,6 +26,182 @@
 #include "vectors.h"
 #include <hardware/blit.h>
 
+/*
+ * Blitter queue
+ *
+ * Blit operations are described by a blit_t and added to a ring of
+ * pending blits. If the Blitter is idle, the blit is started immediately.
+ * Otherwise, it is started from the Blitter-finished interrupt handler
+ * when the previous blit completes. This allows the CPU to continue with
+ * other work while the Blitter runs. Code which accesses bitplanes with
+ * the CPU must first call WaitBlit(), which waits for the queue to drain.
+ */
+#define BLIT_QUEUE_SIZE 16
+static blit_t         blit_queue[BLIT_QUEUE_SIZE];
+static volatile uint  blit_queue_head;  // Next blit to be started
+static volatile uint  blit_queue_tail;  // Next free queue entry
+static volatile uint  blit_queued;      // Count of blits ever queued
+static volatile uint  blit_started;     // Count of blits ever started
+
+/*
+ * blitter_is_busy
+ * ---------------
+ * Returns non-zero (true) if the blitter is busy
+ */
+static uint
+blitter_is_busy(void)
+{
+    /* Test twice to cover blitter bugs (from NetBSD) */
+    return ((*DMACONR & DMACON_BBUSY) ||
+            (*DMACONR & DMACON_BBUSY));
+}
+
+/*
+ * blit_start
+ * ----------
+ * Load the Blitter registers from the specified descriptor and start it.
+ */
+static void
+blit_start(const blit_t *b)
+{
+    *BLTCON0 = b->bq_con0;
+    *BLTCON1 = b->bq_con1;
+    *BLTAFWM = b->bq_afwm;
+    *BLTALWM = b->bq_alwm;
+    *BLTAMOD = b->bq_amod;
+    *BLTBMOD = b->bq_bmod;
+    *BLTCMOD = b->bq_cmod;
+    *BLTDMOD = b->bq_dmod;
+    *BLTAPT  = b->bq_apt;
+    *BLTBPT  = b->bq_bpt;
+    *BLTCPT  = b->bq_cpt;
+    *BLTDPT  = b->bq_dpt;
+    *BLTADAT = b->bq_adat;
+    *BLTBDAT = b->bq_bdat;
+    *BLTSIZE = b->bq_size;  // Starts the Blitter
+}
+
+/*
+ * blit_queue_start_next
+ * ---------------------
+ * Start the next queued blit if the Blitter is idle. Must be called
+ * with interrupts disabled.
+ */
+static void
+blit_queue_start_next(void)
+{
+    uint head = blit_queue_head;
+    if ((head == blit_queue_tail) || blitter_is_busy())
+        return;
+
+    *INTREQ = INTREQ_BLIT;  // Discard stale completion interrupt
+    blit_start(&blit_queue[head]);
+    blit_queue_head = (head + 1) % BLIT_QUEUE_SIZE;
+    blit_started++;
+}
+
+/*
+ * blit_queue_irq
+ * --------------
+ * Called by the level 3 interrupt handler when the Blitter has finished.
+ */
+void
+blit_queue_irq(void)
+{
+    blit_queue_start_next();
+}
+
+/*
+ * blit_queue_kick
+ * ---------------
+ * Start the next queued blit if the Blitter is idle. This is needed
+ * when waiting with interrupts disabled, since the interrupt handler
+ * can't start the next blit then.
+ */
+static void
+blit_queue_kick(void)
+{
+    uint32_t sr = irq_disable();
+    blit_queue_start_next();
+    irq_restore(sr);
+}
+
+/*
+ * blit_queue_add
+ * --------------
+ * Add a blit to the queue, starting it immediately if the Blitter is idle.
+ * If the queue is full, this function waits for an entry to become free.
+ */
+void
+blit_queue_add(const blit_t *b)
+{
+    uint32_t sr;
+    uint     next;
+
+    while (1) {
+        sr = irq_disable();
+        next = (blit_queue_tail + 1) % BLIT_QUEUE_SIZE;
+        if (next != blit_queue_head)
+            break;
+        blit_queue_start_next();
+        irq_restore(sr);
+    }
+    blit_queue[blit_queue_tail] = *b;
+    blit_queue_tail = next;
+    blit_queued++;
+    blit_queue_start_next();
+    irq_restore(sr);
+}
+
+/*
+ * blit_queue_mark
+ * ---------------
+ * Return a mark which may later be passed to blit_queue_wait() to wait
+ * for all blits queued up to this point to complete.
+ */
+uint
+blit_queue_mark(void)
+{
+    return (blit_queued);
+}
+
+/*
+ * blit_queue_wait
+ * ---------------
+ * Wait until all blits queued before the specified mark have completed.
+ */
+void
+blit_queue_wait(uint mark)
+{
+    while (1) {
+        /* Read the started count before checking busy to avoid a race */
+        uint done = blit_started;
+        if (blitter_is_busy())
+            done--;
+        if ((int) (done - mark) >= 0)
+            break;
+        blit_queue_kick();
+    }
+}
+
+/*
+ * WaitBlit
+ * --------
+ * Barrier which waits until all queued blits have completed and the
+ * Blitter is not busy. This must be called before the CPU accesses
+ * any bitplane memory which a blit might be using.
+ */
+void
+WaitBlit(void)
+{
+    while ((blit_queue_head != blit_queue_tail) || blitter_is_busy()) {
+        blit_queue_kick();
+        __asm("nop");
+        __asm("nop");
+        __asm("nop");
+    }
+}
+
 void
 fill_rect_cpu(uint fgpen, uint x1, uint y1, uint x2, uint y2)
 {
@@ -43,9 +219,9 @@ fill_rect_cpu(uint fgpen, uint x1, uint y1, uint x2, uint y2)
 
 //  printf(" %x:%x:%x", x1, left, left_mask);
 //  printf(" %x:%x:%x", x2, right, right_mask);
+    WaitBlit();  // Don't race with queued Blitter operations
     for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
-        uintptr_t src = BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
-                        (y1 * SCREEN_WIDTH / 8) + left / 8;
+        uintptr_t src = screen_line_addr(plane, y1) + left / 8;
         uint16_t *rptr = (uint16_t *) src;
         for (uint line = 0; line < blit_height; line++) {
             uint16_t *ptr = rptr;
@@ -74,7 +250,7 @@ fill_rect_cpu(uint fgpen, uint x1, uint y1, uint x2, uint y2)
                     *ptr |= (left_mask & right_mask);
                 }
             }
-            rptr += SCREEN_WIDTH / 8 / 2;
+            SCREEN_NEXT_LINE(rptr, plane);
         }
     }
 }
@@ -121,6 +297,7 @@ fill_rect_blit(uint fgpen, uint x1, uint y1, uint x2, uint y2, uint8_t xor,
     uint16_t bltmod = (SCREEN_WIDTH - blit_width_pixels) / 8;  // in bytes
     uint16_t left_mask  = 0xffff >> (x1 & 0xf);
     uint16_t right_mask = 0xffff << (16 - (x2 & 0xf));
+    blit_t   b;
     if (right_mask == 0)
         right_mask = 0xffff;
 
@@ -128,53 +305,61 @@ fill_rect_blit(uint fgpen, uint x1, uint y1, uint x2, uint y2, uint8_t xor,
 //  printf(" %x:%x:%x", x1, left, left_mask);
 //  printf(" %x:%x:%x", x2, right, right_mask);
     for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
-#ifdef DO_DESCENDING
-        /*
-         * the address of source A and D has to be the word that defines
-         * the right bottom corner
-         */
-        uintptr_t src = BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
-                        (y2 * SCREEN_WIDTH / 8) + right / 8;
-#else
-        uintptr_t src = BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
-                        (y1 * SCREEN_WIDTH / 8) + left / 8;
-#endif
-        WaitBlit();
+        uint y;
+        uint lines;
+        memset(&b, 0, sizeof (b));
 
 //      printf(" %x:%x", x1, BIT(x1 & 0xf) - 1);
         if ((fgpen & BIT(plane)) == 0) {
             /* Erase area */
             // XXX: Bug: over-erases area
-            *BLTCON0 = 0x0100;
-            *BLTCON1 = 0x0000;
+            b.bq_con0 = 0x0100;
+            b.bq_con1 = 0x0000;
         } else {
-            *BLTADAT = 0xffff;   // Pre-load A value
+            b.bq_adat = 0xffff;  // Pre-load A value
 #ifdef DO_DESCENDING
             /* descending mode + fill parameters */
-            *BLTCON1 = fill_mode | (fill_carry_input << 2) | BIT(1);
-            *BLTCON0 = 0x09f0;   // enable channels A and D, LF := D = A
+            b.bq_con1 = fill_mode | (fill_carry_input << 2) | BIT(1);
+            b.bq_con0 = 0x09f0;  // enable channels A and D, LF := D = A
 #else
             /* ascending mode + fill parameters */
-            *BLTCON1 = fill_mode | (fill_carry_input << 2);
-            *BLTCON0 = 0x01f0;   // enable channel D, LF := D = A
+            b.bq_con1 = fill_mode | (fill_carry_input << 2);
+            b.bq_con0 = 0x01f0;  // enable channel D, LF := D = A
 #endif
         }
 #ifdef DO_DESCENDING
-        *BLTAFWM = right_mask;
-        *BLTALWM = left_mask;
+        b.bq_afwm = right_mask;
+        b.bq_alwm = left_mask;
 #else
-        *BLTAFWM = left_mask;
-        *BLTALWM = right_mask;
+        b.bq_afwm = left_mask;
+        b.bq_alwm = right_mask;
 #endif
-//      *BLTAFWM = 0xffff;
-//      *BLTALWM = 0xffff;
 
-        *BLTDPT  = src;
-        *BLTAPT  = src;
-        *BLTDMOD = bltmod;
-        *BLTAMOD = bltmod;
+        b.bq_dmod = bltmod;
+        b.bq_amod = bltmod;
 
-        *BLTSIZE = (blit_height << 6) | (num_words & 0x3f);
+        /* The blit is split where the bitplane ring wraps */
+        for (y = y1, lines = blit_height; lines != 0; ) {
+            uint chunk = screen_lines_to_wrap(y);
+            if (chunk > lines)
+                chunk = lines;
+#ifdef DO_DESCENDING
+            /*
+             * the address of source A and D has to be the word that defines
+             * the right bottom corner
+             */
+            uintptr_t src = screen_line_addr(plane, y + chunk - 1) +
+                            right / 8;
+#else
+            uintptr_t src = screen_line_addr(plane, y) + left / 8;
+#endif
+            b.bq_dpt  = src;
+            b.bq_apt  = src;
+            b.bq_size = (chunk << 6) | (num_words & 0x3f);
+            blit_queue_add(&b);
+            y     += chunk;
+            lines -= chunk;
+        }
 // break;  // only update bitplane 0 for now
     }
 }
@@ -218,9 +403,9 @@ gray_rect_cpu(uint fgpen, uint x1, uint y1, uint x2, uint y2)
 
 //  printf(" %x:%x:%x", x1, left, left_mask);
 //  printf(" %x:%x:%x", x2, right, right_mask);
+    WaitBlit();  // Don't race with queued Blitter operations
     for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
-        uintptr_t src = BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
-                        (y1 * SCREEN_WIDTH / 8) + left / 8;
+        uintptr_t src = screen_line_addr(plane, y1) + left / 8;
         uint16_t *rptr = (uint16_t *) src;
         for (uint line = 0; line < blit_height; line++) {
             uint16_t *ptr = rptr;
@@ -258,7 +443,7 @@ gray_rect_cpu(uint fgpen, uint x1, uint y1, uint x2, uint y2)
                 }
                 *ptr |= right_mask;
             }
-            rptr += SCREEN_WIDTH / 8 / 2;
+            SCREEN_NEXT_LINE(rptr, plane);
         }
     }
 }
@@ -270,6 +455,100 @@ gray_rect(uint fgpen, uint x1, uint y1, uint x2, uint y2)
     gray_rect_cpu(fgpen, x1, y1, x2, y2);
 }
 
+/*
+ * Minterms for blit_text(), indexed by whether the foreground (bit 1)
+ * and background (bit 0) colors select the bitplane being drawn.
+ *   A = Mask of destination text area
+ *   B = Rendered text
+ *   C = Existing screen contents
+ */
+static const uint8_t blit_text_minterm[] = {
+    0x0a,  // Empty:       D = (!A)C
+    0x3a,  // Invert Text: D = A(!B) | (!A)C
+    0xca,  // Text:        D = AB | (!A)C
+    0xfa,  // Solid:       D = A | C
+};
+
+/*
+ * blit_text
+ * ---------
+ * Transfer a line of already rendered text to all bitplanes of the screen
+ * using the Blitter. The source buffer must be in chip RAM, word aligned,
+ * and hold FONT_HEIGHT lines of src_stride bytes each, with the first
+ * character starting at the first byte of every line. The text may be
+ * placed at any pixel x position; the source is shifted to match and
+ * channel A masks off the destination pixels to either side of the text.
+ *
+ * The blits are only queued here. The caller must not modify the source
+ * buffer until the Blitter has finished with it (see blit_queue_mark()).
+ *
+ * Returns non-zero if the text is too wide to be handled by the Blitter.
+ */
+uint
+blit_text(const uint8_t *src, uint src_stride, uint len, uint x, uint y,
+          uint fg_color, uint bg_color)
+{
+    uint      plane;
+    uint      shift       = x & 0xf;
+    uint      num_words   = (shift + len * FONT_WIDTH + 0xf) / 16;
+    uint      right_bits  = (x + len * FONT_WIDTH) & 0xf;
+    uint16_t  left_mask   = 0xffff >> shift;
+    uint16_t  right_mask  = (right_bits == 0) ? 0xffff :
+                                                (0xffff << (16 - right_bits));
+    uint16_t  src_mod     = src_stride - num_words * 2;
+    uint16_t  dst_mod     = (SCREEN_WIDTH / 8) - num_words * 2;
+    uint      lines1      = screen_lines_to_wrap(y);
+    blit_t    b;
+
+    if ((num_words > 64) || (num_words * 2 > src_stride) ||
+        (((uintptr_t) src | src_stride) & 1))
+        return (1);  // Too wide or not aligned
+
+    memset(&b, 0, sizeof (b));
+    b.bq_con1 = shift << 12;
+    b.bq_afwm = left_mask;
+    b.bq_alwm = right_mask;
+    b.bq_adat = 0xffff;
+    b.bq_bmod = src_mod;
+    b.bq_cmod = dst_mod;
+    b.bq_dmod = dst_mod;
+    if (lines1 > FONT_HEIGHT)
+        lines1 = FONT_HEIGHT;
+
+    for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
+        uintptr_t dst = screen_line_addr(plane, y) + (x / 16) * 2;
+        uint mode = ((fg_color & BIT(plane)) ? 2 : 0) |
+                    ((bg_color & BIT(plane)) ? 1 : 0);
+
+        /*
+         * A is not fetched; its constant data is masked by the first and
+         * last word masks to select only the text area of the destination.
+         * The masks are applied before the A shift, so A is not shifted;
+         * the masks are already in destination coordinates. Only B (the
+         * text) is shifted. Bits which B shifts in from the end of the
+         * previous line fall outside of the text area, so they are masked.
+         */
+        b.bq_con0 = BLTCON0_AREA_USEB | BLTCON0_AREA_USEC |
+                    BLTCON0_AREA_USED | blit_text_minterm[mode];
+        b.bq_bpt  = (uintptr_t) src;
+        b.bq_cpt  = dst;
+        b.bq_dpt  = dst;
+        b.bq_size = (lines1 << 6) | (num_words & 0x3f);
+        blit_queue_add(&b);
+
+        if (lines1 < FONT_HEIGHT) {
+            /* The remaining lines are at the start of the bitplane ring */
+            dst = screen_line_addr(plane, y + lines1) + (x / 16) * 2;
+            b.bq_bpt  = (uintptr_t) src + lines1 * src_stride;
+            b.bq_cpt  = dst;
+            b.bq_dpt  = dst;
+            b.bq_size = ((FONT_HEIGHT - lines1) << 6) | (num_words & 0x3f);
+            blit_queue_add(&b);
+        }
+    }
+    return (0);
+}
+
 #undef TAKEN_FROM_THE_INTERNET_UNTESTED
 #ifdef TAKEN_FROM_THE_INTERNET_UNTESTED
 //
@@ -598,7 +877,6 @@ void
 draw_line(uint fgpen, int x1, int y1, int x2, int y2)
 {
     UWORD dx = abs(x2 - x1), dy = abs(y2 - y1), dmax, dmin;
-    UWORD bytes_per_line = SCREEN_WIDTH / 8;
     int   plane;                    // bitplane depends on the color choice
     UBYTE pattern_offset = 0;       // or 3 if line_pattern is 0xcccc
     UBYTE lf_byte = LF_COOKIE_CUT;  // or LF_XOR
@@ -606,6 +884,28 @@ draw_line(uint fgpen, int x1, int y1, int x2, int y2)
     UBYTE omit_first_pixel = FALSE; // Is this ever desirable?
     UWORD line_pattern = 0xffff;    // maybe also 0xcccc
 
+    /*
+     * The Blitter can't follow the bitplane ring around, so a line which
+     * crosses the end of the ring is drawn in two parts.
+     */
+    if (y1 != y2) {
+        int ytop  = (y1 < y2) ? y1 : y2;
+        int ybot  = (y1 < y2) ? y2 : y1;
+        int ywrap = ytop + screen_lines_to_wrap(ytop);
+        if (ybot >= ywrap) {
+            int xa = x1 + (x2 - x1) * (ywrap - 1 - y1) / (y2 - y1);
+            int xb = x1 + (x2 - x1) * (ywrap - y1) / (y2 - y1);
+            if (y1 < y2) {
+                draw_line(fgpen, x1, y1, xa, ywrap - 1);
+                draw_line(fgpen, xb, ywrap, x2, y2);
+            } else {
+                draw_line(fgpen, xb, ywrap, x1, y1);
+                draw_line(fgpen, x2, y2, xa, ywrap - 1);
+            }
+            return;
+        }
+    }
+
     /*
      * Perform the same blitter set-bits operation on every plane which is
      * part of the current draw color. Planes which are not part of the
@@ -644,35 +944,35 @@ draw_line(uint fgpen, int x1, int y1, int x2, int y2)
         UWORD sign = (aptlval < 0 ? 1 : 0) << 6;
         UWORD bltcon1val = texture | sign | (code << 2) | (single << 1) | 0x01;
 
-        APTR start_address = (APTR) BITPLANE_0_BASE +
-                             plane * BITPLANE_OFFSET +
-                             y1 * bytes_per_line + x1 / 8;
-
-        WaitBlit();
-        *BLTAPT  = ((UWORD) aptlval);
-        *BLTCPT  = (uintptr_t) start_address;
+        APTR start_address = (APTR) screen_line_addr(plane, y1) + x1 / 8;
 
         /*
          * If the first pixel is not to be plotted, then scratchmem will be
          * used in place of the start address.
          */
         static UWORD __chip scratchmem[12];
+        blit_t b;
 
-        *BLTDPT  = (uintptr_t) (omit_first_pixel ? scratchmem : start_address);
+        b.bq_apt  = ((UWORD) aptlval);
+        b.bq_bpt  = 0;
+        b.bq_cpt  = (uintptr_t) start_address;
+        b.bq_dpt  = (uintptr_t) (omit_first_pixel ? scratchmem :
+                                                      start_address);
 
-        *BLTAMOD = 4 * (dmin - dmax);
-        *BLTBMOD = 4 * dmin;
+        b.bq_amod = 4 * (dmin - dmax);
+        b.bq_bmod = 4 * dmin;
 
-        *BLTCMOD = SCREEN_WIDTH / 8;  // destination width in bytes
-        *BLTDMOD = SCREEN_WIDTH / 8;
-        *BLTCON0 = 0x0b00 | lf_byte | startx;
-        *BLTCON1 = bltcon1val;
+        b.bq_cmod = SCREEN_WIDTH / 8;  // destination width in bytes
+        b.bq_dmod = SCREEN_WIDTH / 8;
+        b.bq_con0 = 0x0b00 | lf_byte | startx;
+        b.bq_con1 = bltcon1val;
 
-        *BLTADAT = 0x8000;  // draw "pen" pixel
-        *BLTBDAT = line_pattern;
-        *BLTAFWM = 0xffff;
-        *BLTALWM = 0xffff;
+        b.bq_adat = 0x8000;  // draw "pen" pixel
+        b.bq_bdat = line_pattern;
+        b.bq_afwm = 0xffff;
+        b.bq_alwm = 0xffff;
 
-        *BLTSIZE = ((dmax + 1) << 6) + 2;
+        b.bq_size = ((dmax + 1) << 6) + 2;
+        blit_queue_add(&b);
     }
 }
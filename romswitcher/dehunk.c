@@ -8,10 +8,12 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
+#include <unistd.h>
 #include <err.h>
+#include "lz.h"
 
 #define DPRINTF(...) if (txtout != NULL) fprintf(txtout, __VA_ARGS__)
 
@@ -43,6 +45,30 @@
 #define HUNK_RELRELOC32   1021
 #define HUNK_ABSRELOC16   1022
 
+#define HUNK_SIZE_MASK    0x3fffffff  // Upper bits are memory type flags
+#define MAX_HUNKS         16
+#define MAX_SECTIONS      64
+#define DEFAULT_ROM_BASE  0x00f80000
+
+/*
+ * A relocation of one longword in the current section. The final value
+ * is the stored value plus the run address of the target hunk.
+ */
+typedef struct {
+    uint32_t r_offset;      // Byte offset in the current section
+    uint32_t r_hunk;        // Target hunk number
+} reloc_t;
+
+/*
+ * An output section from the linker map
+ */
+typedef struct {
+    char     ms_name[32];
+    uint32_t ms_vma;        // Run address
+    uint32_t ms_lma;        // Load (ROM image) address
+    uint32_t ms_size;       // Size in bytes
+} map_sect_t;
+
 /*
  * HUNK_HEADER
  */
@@ -91,34 +117,501 @@ typedef struct {
 
 FILE *txtout = NULL;
 
-static uint32_t *
-skip_symbols(uint32_t *cur, uint32_t *bufend)
+static FILE       *ifp;
+static const char *infile;
+static const char *mapfile;
+static char       *tmpname;
+
+/* Current section, held until HUNK_END so relocations may be applied */
+static uint32_t *sect_data;
+static uint      sect_lwords;
+static uint      sect_alloc;
+static int       sect_hunk = -1;
+
+/* Relocations for the current section, merged from all reloc hunks */
+static reloc_t  *relocs;
+static uint      reloc_count;
+static uint      reloc_alloc;
+
+/* Image from this ROM address onward is compressed (-z) */
+static uint32_t  pack_addr;
+static uint32_t  out_addr;
+static uint8_t  *pack_buf;
+static uint      pack_len;
+static uint      pack_alloc;
+
+/* Output sections with contents, in linker map order */
+static map_sect_t map_sects[MAX_SECTIONS];
+static uint       map_count;
+
+/* Run address, image address, and size of each hunk, from the linker map */
+static uint32_t  hunk_addr[MAX_HUNKS];
+static uint32_t  hunk_load[MAX_HUNKS];
+static uint32_t  hunk_bytes[MAX_HUNKS];
+
+static uint32_t
+read32(void)
+{
+    uint32_t value;
+    if (fread(&value, sizeof (value), 1, ifp) != 1)
+        errx(EXIT_FAILURE, "Unexpected end of %s", infile);
+    return (SWAP32(value));
+}
+
+static uint16_t
+read16(void)
+{
+    uint16_t value;
+    if (fread(&value, sizeof (value), 1, ifp) != 1)
+        errx(EXIT_FAILURE, "Unexpected end of %s", infile);
+    return (SWAP16(value));
+}
+
+static int
+read32_eof(uint32_t *value)
+{
+    if (fread(value, sizeof (*value), 1, ifp) != 1)
+        return (1);
+    *value = SWAP32(*value);
+    return (0);
+}
+
+static void
+skip_lwords(uint lwords)
+{
+    if (fseek(ifp, lwords * sizeof (uint32_t), SEEK_CUR) != 0)
+        err(EXIT_FAILURE, "Failed to seek in %s", infile);
+}
+
+/*
+ * Skip HUNK_SYMBOL: a list of (name length, name, value), ended by
+ * a zero name length.
+ */
+static void
+skip_symbols(void)
 {
     uint32_t count;
-    while (cur < bufend) {
-        count = SWAP32(*cur);
-        cur++;  // skip length of this symbol name
-        if (count == 0)
-            break;  // end of this block
+    while ((count = read32()) != 0) {
 #if 0
         DPRINTF("SYMBOL c=%u %08x\n", count, count);
 #endif
-        cur += count + 1;  // # dwords + symbol_offset
+        skip_lwords(count + 1);  // # dwords + symbol_offset
     }
-    return (cur);
 }
 
-static uint32_t *
-skip_debug(uint32_t *cur, uint32_t *bufend)
+static void
+reloc_add(uint32_t offset, uint32_t hunk)
 {
-    uint32_t size;
-    hunk_debug_t *hdr = (hunk_debug_t *) cur;
-    size = SWAP32(hdr->hd_size);
-#if 0
-    DPRINTF("DEBUG size=%x hd_fname_len=%x\n",
-            SWAP32(hdr->hd_size), SWAP32(hdr->hd_fname_len));
-#endif
-    return (cur + size + 1);
+    if (hunk >= MAX_HUNKS)
+        errx(EXIT_FAILURE, "Relocation to invalid hunk %u", hunk);
+    if (reloc_count == reloc_alloc) {
+        reloc_alloc = (reloc_alloc == 0) ? 256 : reloc_alloc * 2;
+        relocs = realloc(relocs, reloc_alloc * sizeof (*relocs));
+        if (relocs == NULL)
+            err(EXIT_FAILURE, "Failed to allocate relocation table");
+    }
+    if (mapfile == NULL)
+        errx(EXIT_FAILURE, "Relocations require a linker map (-m)");
+    relocs[reloc_count].r_offset = offset;
+    relocs[reloc_count].r_hunk   = hunk;
+    reloc_count++;
+}
+
+/*
+ * Read HUNK_RELOC32 (longword entries) or HUNK_RELOC32SHORT / HUNK_DREL32
+ * (word entries, padded to a longword at the end): a list of
+ * (count, target hunk, offsets...), ended by a zero count.
+ */
+static void
+read_relocs(uint shortform)
+{
+    uint32_t count;
+    uint     words = 0;
+
+    for (;;) {
+        uint32_t hunk;
+        if (shortform) {
+            count = read16();
+            words++;
+            if (count == 0)
+                break;
+            hunk = read16();
+            words++;
+            for (; count > 0; count--, words++)
+                reloc_add(read16(), hunk);
+        } else {
+            count = read32();
+            if (count == 0)
+                break;
+            hunk = read32();
+            while (count-- > 0)
+                reloc_add(read32(), hunk);
+        }
+    }
+    if (words & 1)
+        fseek(ifp, sizeof (uint16_t), SEEK_CUR);  // Longword padding
+}
+
+static int
+reloc_compare(const void *a, const void *b)
+{
+    const reloc_t *ra = a;
+    const reloc_t *rb = b;
+
+    if (ra->r_offset != rb->r_offset)
+        return ((ra->r_offset < rb->r_offset) ? -1 : 1);
+    if (ra->r_hunk != rb->r_hunk)
+        return ((ra->r_hunk < rb->r_hunk) ? -1 : 1);
+    return (0);
+}
+
+/*
+ * Sort and merge the relocations gathered for the current section, then
+ * apply them in ascending address order.
+ */
+static void
+reloc_apply(void)
+{
+    uint     cur;
+    uint     out = 0;
+    uint     runs = 0;
+
+    if (reloc_count == 0)
+        return;
+    qsort(relocs, reloc_count, sizeof (*relocs), reloc_compare);
+
+    for (cur = 0; cur < reloc_count; cur++) {
+        reloc_t *r = &relocs[cur];
+        uint32_t *ptr;
+        uint8_t  *bptr;
+        uint32_t  value;
+
+        if (out > 0) {
+            reloc_t *prev = &relocs[out - 1];
+            if (prev->r_offset == r->r_offset) {
+                if (prev->r_hunk == r->r_hunk)
+                    continue;  // Duplicate from another reloc hunk
+                errx(EXIT_FAILURE, "Hunk %d offset 0x%x relocated twice",
+                     sect_hunk, r->r_offset);
+            }
+            if (prev->r_offset + sizeof (uint32_t) > r->r_offset)
+                errx(EXIT_FAILURE, "Hunk %d offset 0x%x overlaps 0x%x",
+                     sect_hunk, r->r_offset, prev->r_offset);
+            if ((prev->r_hunk != r->r_hunk) ||
+                (prev->r_offset + sizeof (uint32_t) != r->r_offset))
+                runs++;
+        } else {
+            runs++;
+        }
+        if (r->r_offset + sizeof (uint32_t) > sect_lwords * sizeof (uint32_t))
+            errx(EXIT_FAILURE, "Hunk %d relocation offset 0x%x out of range",
+                 sect_hunk, r->r_offset);
+
+        /* Offsets need only be word aligned */
+        bptr = (uint8_t *) sect_data + r->r_offset;
+        ptr = (uint32_t *) bptr;
+        memcpy(&value, ptr, sizeof (value));
+        value = SWAP32(SWAP32(value) + hunk_addr[r->r_hunk]);
+        memcpy(ptr, &value, sizeof (value));
+        relocs[out++] = *r;
+    }
+    DPRINTF("RELOC  %u entries (%u merged) in %u runs\n",
+            out, reloc_count - out, runs);
+    reloc_count = 0;
+}
+
+/*
+ * Read a CODE or DATA hunk into the section buffer. It is written out
+ * once the section's relocations are known, at HUNK_END.
+ */
+static void
+read_section(int hunk, uint lwords)
+{
+    if (lwords > sect_alloc) {
+        sect_alloc = lwords;
+        sect_data = realloc(sect_data, (uint) (sect_alloc * sizeof (uint32_t)));
+        if (sect_data == NULL) {
+            err(EXIT_FAILURE, "Failed to allocate %u bytes",
+                (uint) (sect_alloc * sizeof (uint32_t)));
+        }
+    }
+    if ((lwords != 0) &&
+        (fread(sect_data, lwords * sizeof (uint32_t), 1, ifp) != 1)) {
+        errx(EXIT_FAILURE, "Failed to read %u bytes of %s",
+             (uint) (lwords * sizeof (uint32_t)), infile);
+    }
+    sect_lwords = lwords;
+    sect_hunk = hunk;
+}
+
+/*
+ * Write image bytes, diverting anything at or beyond the -z address to
+ * the buffer which is compressed at the end.
+ */
+static void
+output_write(FILE *ofp, const void *buf, uint len)
+{
+    const uint8_t *ptr = buf;
+    uint           direct = len;
+
+    if ((pack_addr != 0) && (out_addr + len > pack_addr))
+        direct = (out_addr < pack_addr) ? pack_addr - out_addr : 0;
+
+    if ((direct != 0) && (fwrite(ptr, direct, 1, ofp) != 1))
+        err(EXIT_FAILURE, "Failed to write %u bytes\n", direct);
+    if (direct < len) {
+        if (pack_len + len - direct > pack_alloc) {
+            pack_alloc = (pack_len + len - direct) * 2;
+            pack_buf = realloc(pack_buf, pack_alloc);
+            if (pack_buf == NULL)
+                err(EXIT_FAILURE, "Failed to allocate compression buffer");
+        }
+        memcpy(pack_buf + pack_len, ptr + direct, len - direct);
+        pack_len += len - direct;
+    }
+    out_addr += len;
+}
+
+/*
+ * Write the current section to the image. With a linker map, the section
+ * is placed at its load address, and only the bytes the linker allocated
+ * to it are written (the hunk may be padded to a longword).
+ */
+static void
+flush_section(FILE *ofp)
+{
+    static const uint8_t zero[64];
+    uint32_t len = sect_lwords * sizeof (uint32_t);
+
+    if (sect_hunk < 0) {
+        if (reloc_count != 0)
+            errx(EXIT_FAILURE, "Relocations outside of a section");
+        return;
+    }
+    reloc_apply();
+    if (mapfile != NULL) {
+        uint32_t load = hunk_load[sect_hunk];
+        if (load < out_addr) {
+            errx(EXIT_FAILURE, "Hunk %d at 0x%x overlaps previous data "
+                 "ending at 0x%x", sect_hunk, load, out_addr);
+        }
+        while (out_addr < load) {
+            uint32_t gap = load - out_addr;
+            output_write(ofp, zero, (gap < sizeof (zero)) ? gap : sizeof (zero));
+        }
+        if (len > hunk_bytes[sect_hunk])
+            len = hunk_bytes[sect_hunk];
+    }
+    output_write(ofp, sect_data, len);
+    for (; len < hunk_bytes[sect_hunk]; len += sizeof (zero)) {
+        uint32_t left = hunk_bytes[sect_hunk] - len;
+        output_write(ofp, zero, (left < sizeof (zero)) ? left : sizeof (zero));
+    }
+    sect_hunk = -1;
+}
+
+/*
+ * Read the output sections from a GNU ld map file. An output section line
+ * starts in the first column with the section name, which may be followed
+ * on the same or the next line by its address, size, and (for sections
+ * with a separate load address) "load address <lma>". Empty sections are
+ * dropped, since the linker does not create hunks for them.
+ */
+static void
+read_map(void)
+{
+    FILE *mfp;
+    char  line[512];
+    char  name[sizeof (map_sects[0].ms_name)];
+    uint  in_map = 0;
+
+    if ((mfp = fopen(mapfile, "r")) == NULL)
+        err(EXIT_FAILURE, "fopen(%s) for map fail", mapfile);
+
+    name[0] = '\0';
+    while (fgets(line, sizeof (line), mfp) != NULL) {
+        const char *ptr = line;
+        unsigned long vma;
+        unsigned long size;
+        unsigned long lma;
+        int           pos = 0;
+
+        if (in_map == 0) {
+            if (strncmp(line, "Linker script and memory map", 28) == 0)
+                in_map = 1;
+            continue;
+        }
+        if (line[0] == '.') {
+            /* Output section name, possibly followed by its address */
+            int len = strcspn(line, " \t\n");
+            if (len >= (int) sizeof (name))
+                len = sizeof (name) - 1;
+            memcpy(name, line, len);
+            name[len] = '\0';
+            ptr = line + len;
+        } else if ((name[0] == '\0') || !isspace((uint8_t) line[0])) {
+            name[0] = '\0';
+            continue;
+        }
+        if (sscanf(ptr, " 0x%lx 0x%lx%n", &vma, &size, &pos) != 2) {
+            if (ptr == line)
+                name[0] = '\0';  // Not the address line of a section
+            continue;
+        }
+        lma = vma;
+        (void) sscanf(ptr + pos, " load address 0x%lx", &lma);
+        if (size != 0) {
+            map_sect_t *ms;
+            if (map_count >= MAX_SECTIONS)
+                errx(EXIT_FAILURE, "Too many sections in %s", mapfile);
+            ms = &map_sects[map_count++];
+            strcpy(ms->ms_name, name);
+            ms->ms_vma  = vma;
+            ms->ms_lma  = lma;
+            ms->ms_size = size;
+            DPRINTF("MAP    %-10s vma=0x%08x lma=0x%08x size=0x%x\n",
+                    ms->ms_name, ms->ms_vma, ms->ms_lma, ms->ms_size);
+        }
+        name[0] = '\0';
+    }
+    fclose(mfp);
+    if (map_count == 0)
+        errx(EXIT_FAILURE, "No output sections found in %s", mapfile);
+}
+
+/*
+ * Compress the collected image tail with a greedy LZ matcher, using a
+ * hash of the next LZ_MIN_MATCH bytes to find the most recent candidate.
+ * Returns the packed length, including the header.
+ */
+#define LZ_HASH_BITS 14
+static uint
+lz_pack(uint8_t *out, const uint8_t *in, uint len)
+{
+    static uint32_t hash_pos[1 << LZ_HASH_BITS];
+    uint8_t *optr = out + LZ_HDR_SIZE;
+    uint     lit_start = 0;
+    uint     pos = 0;
+    uint     packed;
+
+    memset(hash_pos, 0xff, sizeof (hash_pos));
+    while (1) {
+        uint match_len = 0;
+        uint match_off = 0;
+
+        if (pos + LZ_MIN_MATCH <= len) {
+            uint32_t key  = (in[pos] << 16) | (in[pos + 1] << 8) | in[pos + 2];
+            uint     hash = (key * 2654435761U) >> (32 - LZ_HASH_BITS);
+            uint32_t cand = hash_pos[hash];
+            hash_pos[hash] = pos;
+            if ((cand != 0xffffffff) && (pos - cand <= LZ_MAX_OFFSET)) {
+                while ((pos + match_len < len) &&
+                       (in[cand + match_len] == in[pos + match_len]))
+                    match_len++;
+                match_off = pos - cand;
+            }
+        }
+        if ((match_len < LZ_MIN_MATCH) && (pos < len)) {
+            pos++;
+            continue;
+        }
+
+        /* Emit a sequence: literals, then the match (if any) */
+        uint lits = pos - lit_start;
+        uint mlen = (match_len >= LZ_MIN_MATCH) ? match_len - LZ_MIN_MATCH : 0;
+        uint8_t *token = optr++;
+        *token = ((lits < 15) ? lits : 15) << 4;
+        if (lits >= 15) {
+            uint ext = lits - 15;
+            for (; ext >= 255; ext -= 255)
+                *optr++ = 255;
+            *optr++ = ext;
+        }
+        memcpy(optr, in + lit_start, lits);
+        optr += lits;
+        if (pos >= len)
+            break;
+
+        *optr++ = match_off >> 8;
+        *optr++ = match_off;
+        *token |= (mlen < 15) ? mlen : 15;
+        if (mlen >= 15) {
+            uint ext = mlen - 15;
+            for (; ext >= 255; ext -= 255)
+                *optr++ = 255;
+            *optr++ = ext;
+        }
+        pos += match_len;
+        lit_start = pos;
+    }
+
+    packed = optr - out;
+    for (pos = 0; pos < 4; pos++) {
+        out[pos]     = (uint32_t) LZ_MAGIC >> (24 - pos * 8);
+        out[4 + pos] = len >> (24 - pos * 8);
+        out[8 + pos] = packed >> (24 - pos * 8);
+    }
+    return (packed);
+}
+
+/*
+ * Write the collected image tail, compressed.
+ */
+static void
+pack_flush(FILE *ofp)
+{
+    uint8_t *out;
+    uint     packed;
+
+    if (pack_addr == 0)
+        return;
+    out = malloc(pack_len + pack_len / 255 + LZ_HDR_SIZE + 16);
+    if (out == NULL)
+        err(EXIT_FAILURE, "Failed to allocate compression buffer");
+    packed = lz_pack(out, pack_buf, pack_len);
+    DPRINTF("LZ     0x%x: %u -> %u bytes\n", pack_addr, pack_len, packed);
+    if (fwrite(out, packed, 1, ofp) != 1)
+        err(EXIT_FAILURE, "Failed to write %u bytes\n", packed);
+    free(out);
+}
+
+/*
+ * Return non-zero if the two files have identical contents.
+ */
+static int
+files_match(const char *name1, const char *name2)
+{
+    FILE  *fp1;
+    FILE  *fp2;
+    char   buf1[8192];
+    char   buf2[8192];
+    size_t len1;
+    size_t len2;
+    int    match = 0;
+
+    if ((fp1 = fopen(name1, "r")) == NULL)
+        return (0);
+    if ((fp2 = fopen(name2, "r")) != NULL) {
+        do {
+            len1 = fread(buf1, 1, sizeof (buf1), fp1);
+            len2 = fread(buf2, 1, sizeof (buf2), fp2);
+        } while ((len1 == len2) && (len1 != 0) &&
+                 (memcmp(buf1, buf2, len1) == 0));
+        match = (len1 == 0) && (len2 == 0);
+        fclose(fp2);
+    }
+    fclose(fp1);
+    return (match);
+}
+
+/*
+ * Don't leave a partial image behind if conversion fails.
+ */
+static void
+remove_tmpfile(void)
+{
+    if (tmpname != NULL)
+        unlink(tmpname);
 }
 
 static void
@@ -126,31 +619,52 @@ usage(void)
 {
     fprintf(stderr,
             "This program is used to convert an Amiga hunk file to ROM image.\n"
-            "Usage: dehunk [-v] infile outfile\n"
+            "Usage: dehunk [-v] [-b base] [-m mapfile] [-z addr] "
+            "infile outfile\n"
+            "-b  ROM address of the image when no map is given "
+            "(default 0x%x)\n"
+            "-m  linker map giving the run and load address of each hunk\n"
+            "-z  LZ compress the image from the given ROM address onward\n"
             "-h  display help\n"
-            "-v  verbose output\n");
+            "-v  verbose output\n"
+            "Without -m, hunks are written back to back and relocations\n"
+            "are rejected. The outfile is only replaced if its contents\n"
+            "would change.\n",
+            DEFAULT_ROM_BASE);
 }
 
 uint
 main(int argc, char *argv[])
 {
     int arg;
-    const char *infile = NULL;
     const char *outfile = NULL;
-    struct stat st;
-    FILE *ifp;
     FILE *ofp;
-    uint filesize;
-    uint32_t *buf;
-    uint32_t *bufend;
-    uint32_t *cur;
-    hunk_header_t *hh;
+    uint32_t rom_base = DEFAULT_ROM_BASE;
+    uint32_t hunktype;
+    uint first;
+    uint hunks;
+    uint hunknum;
 
     for (arg = 1; arg < argc; arg++) {
         const char *ptr = argv[arg];
-        if (*ptr == '-') {
+        if (*ptr == '-' && ptr[1] != '\0') {
             for (ptr++; *ptr != '\0'; ptr++) {
                 switch (*ptr) {
+                    case 'b':
+                        if (++arg >= argc)
+                            errx(EXIT_FAILURE, "-b requires an address");
+                        rom_base = strtoul(argv[arg], NULL, 0);
+                        break;
+                    case 'm':
+                        if (++arg >= argc)
+                            errx(EXIT_FAILURE, "-m requires a map file");
+                        mapfile = argv[arg];
+                        break;
+                    case 'z':
+                        if (++arg >= argc)
+                            errx(EXIT_FAILURE, "-z requires an address");
+                        pack_addr = strtoul(argv[arg], NULL, 0);
+                        break;
                     case 'h':
                     case '?':
                         usage();
@@ -177,39 +691,27 @@ main(int argc, char *argv[])
              "Not enough arguments. You must provide infile and outfile");
     }
 
-    if (strcmp(outfile, "-") == 0) {
-        txtout = stderr;
-        ofp = stdout;
-#if 0
-    } else {
-        /* Verify outfile doesn't exist */
-        if (stat(outfile, &st) == 0)
-            errx(EXIT_FAILURE, "output file %s already exists", outfile);
-#endif
-    }
-
-    /* Get size of infile */
-    if (stat(infile, &st) != 0)
-        err(EXIT_FAILURE, "stat(%s) fail", infile);
-
-    DPRINTF("size %u\n", st.st_size);
-    filesize = st.st_size;
-
-    buf = malloc(filesize);
-    if (buf == NULL)
-        err(EXIT_FAILURE, "Failed to allocate %u bytes", filesize);
+    if (mapfile != NULL)
+        read_map();
 
     if ((ifp = fopen(infile, "r")) == NULL)
         err(EXIT_FAILURE, "fopen(%s) for input fail", infile);
 
-    if (fread(buf, filesize, 1, ifp) != 1)
-        err(EXIT_FAILURE, "Failed to read %u bytes of %s", filesize, infile);
-
-    /* Should find HUNK_HEADER */
-    DPRINTF("%u %x\n", SWAP32(buf[0]), buf[0]);
-    if (buf[0] != SWAP32(HUNK_HEADER)) {
-        errx(EXIT_FAILURE, "Failed to find hunk header %u at offset 0; "
-             "got 0x08x\n", SWAP32(buf[0]), HUNK_HEADER);
+    if (strcmp(outfile, "-") == 0) {
+        txtout = (txtout != NULL) ? stderr : NULL;
+        ofp = stdout;
+    } else {
+        /*
+         * Write to a temporary file first, so that an unchanged image
+         * keeps its timestamp and anything depending on it is not rebuilt.
+         */
+        tmpname = malloc(strlen(outfile) + 5);
+        if (tmpname == NULL)
+            err(EXIT_FAILURE, "malloc");
+        sprintf(tmpname, "%s.tmp", outfile);
+        atexit(remove_tmpfile);
+        if ((ofp = fopen(tmpname, "w")) == NULL)
+            err(EXIT_FAILURE, "fopen(%s) for output fail", tmpname);
     }
 
     /*
@@ -236,87 +738,105 @@ main(int argc, char *argv[])
      * 00000050: 11144ef9 00f80010 4e714e75 00000000
      *           ^^start of ROM
      */
-    hh = (hunk_header_t *) (buf + 1);
-    uint hsize;
-    uint hunknum;
-    DPRINTF("Header table_size=%u first_hunk=%u last_hunk=%u\n",
-            SWAP32(hh->hh_table_size),
-            SWAP32(hh->hh_first_hunk), SWAP32(hh->hh_last_hunk));
-    uint hunks = SWAP32(hh->hh_last_hunk) - SWAP32(hh->hh_first_hunk) + 1;
-    if (hunks > 16) {
+    hunktype = read32();
+    DPRINTF("%u %x\n", hunktype, hunktype);
+    if (hunktype != HUNK_HEADER) {
+        errx(EXIT_FAILURE, "Failed to find hunk header %u at offset 0; "
+             "got 0x%08x\n", HUNK_HEADER, hunktype);
+    }
+    if (read32() != 0)
+        errx(EXIT_FAILURE, "Resident library names are not supported");
+    (void) read32();  // hh_table_size
+    first = read32();
+    hunks = read32() - first + 1;
+    DPRINTF("Header first_hunk=%u hunks=%u\n", first, hunks);
+    if ((first != 0) || (hunks > MAX_HUNKS)) {
         fprintf(stderr, "Strange number of hunks: %u\n", hunks);
         exit(1);
     }
-    cur = (uint32_t *) &(hh->hh_sizes[hunks]);
-    bufend = (uint32_t *) ((uintptr_t) buf + filesize);
-    if ((ofp = fopen(outfile, "w")) == NULL)
-        err(EXIT_FAILURE, "fopen(%s) for output fail", infile);
+
+    /*
+     * Each hunk is one output section of the link, in map order. The map
+     * gives every hunk's run address (.data runs from RAM, for example)
+     * and where its contents belong in the ROM image, before any of the
+     * hunks are read. BSS hunks take no space in the image.
+     */
+    out_addr = rom_base;
+    if ((mapfile != NULL) && (hunks > map_count)) {
+        errx(EXIT_FAILURE, "%s has %u hunks but %s has only %u sections",
+             infile, hunks, mapfile, map_count);
+    }
+    for (hunknum = 0; hunknum < hunks; hunknum++) {
+        uint32_t size = read32();
+        if ((size & ~HUNK_SIZE_MASK) == ~HUNK_SIZE_MASK)
+            (void) read32();  // Extended memory attributes
+        size = (size & HUNK_SIZE_MASK) * sizeof (uint32_t);
+        if (mapfile != NULL) {
+            map_sect_t *ms = &map_sects[hunknum];
+            if ((ms->ms_size + 3) / 4 * 4 != size) {
+                errx(EXIT_FAILURE, "Hunk %u size 0x%x does not match %s "
+                     "size 0x%x in %s", hunknum, size, ms->ms_name,
+                     ms->ms_size, mapfile);
+            }
+            hunk_addr[hunknum]  = ms->ms_vma;
+            hunk_load[hunknum]  = ms->ms_lma;
+            hunk_bytes[hunknum] = ms->ms_size;
+            if (hunknum == 0)
+                out_addr = ms->ms_lma;
+        }
+    }
+
     hunknum = 0;
-    while (cur < bufend) {
-        uint32_t      hsize = SWAP32(hh->hh_sizes[hunknum]);
-        uint          hunktype = SWAP32(*cur);
+    while (read32_eof(&hunktype) == 0) {
         const char   *hunkname;
-        hunk_data_t  *hdata;
-        hunk_code_t  *hcode;
-        uint32_t     *data;
         uint          lwords = 0;
         uint          show = 1;
 
-        hunktype = SWAP32(*cur);
-        switch (hunktype) {
+        switch (hunktype & HUNK_SIZE_MASK) {
             case HUNK_CODE:
                 hunkname = "CODE";
-                hcode = (hunk_code_t *) (cur + 1);
-                lwords = SWAP32(hcode->hc_size);
-                data = (uint32_t *) &(hcode->hc_data[0]);
-                if (fwrite(data, lwords * sizeof (uint32_t), 1, ofp) != 1) {
-                    err(EXIT_FAILURE, "Failed to write %u bytes\n",
-                        lwords * sizeof (uint32_t));
-                }
-                cur = data + lwords;
+                lwords = read32() & HUNK_SIZE_MASK;
+                read_section(hunknum, lwords);
                 break;
             case HUNK_DATA:
                 hunkname = "DATA";
-                hdata = (hunk_data_t *) (cur + 1);
-                lwords = SWAP32(hdata->hd_size);
-                data = (uint32_t *) &(hdata->hd_data[0]);
-                if (fwrite(data, lwords * sizeof (uint32_t), 1, ofp) != 1) {
-                    err(EXIT_FAILURE, "Failed to write %u bytes\n",
-                        lwords * sizeof (uint32_t));
-                }
-                cur = data + lwords;
+                lwords = read32() & HUNK_SIZE_MASK;
+                read_section(hunknum, lwords);
+                break;
+            case HUNK_RELOC32:
+                hunkname = "RELOC32";
+                read_relocs(0);
+                show = 0;
+                break;
+            case HUNK_DREL32:
+            case HUNK_RELOC32SHORT:
+                hunkname = "RELOC32SHORT";
+                read_relocs(1);
+                show = 0;
                 break;
             case HUNK_SYMBOL:
                 hunkname = "SYMBOL";
-                data = skip_symbols(cur + 1, bufend);
-                lwords = data - cur;
-                cur = data;
+                skip_symbols();
                 break;
             case HUNK_DEBUG:
                 hunkname = "DEBUG";
-                data = skip_debug(cur + 1, bufend);
-                lwords = data - cur;
-                cur = data;
+                lwords = read32();
+                skip_lwords(lwords);
                 break;
             case HUNK_BSS:
                 /* Don't need BSS in ROM file */
                 hunkname = "BSS";
-                cur++;
-                lwords = SWAP32(*cur);
-                cur++;
+                lwords = read32() & HUNK_SIZE_MASK;
                 show = 0;
                 break;
             case HUNK_END:
                 hunkname = "END";
-                cur++;
+                flush_section(ofp);
+                hunknum++;
                 break;
             default:
-                fprintf(stderr, "\nUnknown Hunk type %u (0x%x) at 0x%x\n",
-                        hunktype, hunktype,
-                        (uintptr_t) cur - (uintptr_t) buf);
-                fprintf(stderr, "[%08x %08x %08x %08x]\n",
-                        SWAP32(cur[0]), SWAP32(cur[1]), SWAP32(cur[2]),
-                        SWAP32(cur[3]));
+                fprintf(stderr, "\nUnknown Hunk type %u (0x%x) at 0x%lx\n",
+                        hunktype, hunktype, ftell(ifp) - sizeof (uint32_t));
                 exit(1);
         }
         if (show) {
@@ -324,10 +844,21 @@ main(int argc, char *argv[])
                     lwords * sizeof (uint32_t));
         }
     }
+    flush_section(ofp);  // Tolerate a missing final HUNK_END
+    pack_flush(ofp);
 
-    if (ofp != stdout)
-        fclose(ofp);
-fail_read:
-    free(buf);
+    if (ofp != stdout) {
+        if (fclose(ofp) != 0)
+            err(EXIT_FAILURE, "Failed to write %s", tmpname);
+        if (files_match(tmpname, outfile)) {
+            DPRINTF("%s unchanged\n", outfile);
+        } else if (rename(tmpname, outfile) != 0) {
+            err(EXIT_FAILURE, "Failed to rename %s to %s", tmpname, outfile);
+        }
+    }
+    free(sect_data);
+    free(relocs);
+    free(pack_buf);
     fclose(ifp);
+    return (0);
 }
@@ -49,6 +49,32 @@
 #define AREAINFOFLAG_CLOSEDRAW  0x02
 #define AREAINFOFLAG_ELLIPSE    0x03
 
+/* Blitter operation, as queued by blit_queue_add() */
+typedef struct {
+    uint16_t bq_con0;  // BLTCON0
+    uint16_t bq_con1;  // BLTCON1
+    uint16_t bq_afwm;  // BLTAFWM
+    uint16_t bq_alwm;  // BLTALWM
+    uint16_t bq_amod;  // BLTAMOD
+    uint16_t bq_bmod;  // BLTBMOD
+    uint16_t bq_cmod;  // BLTCMOD
+    uint16_t bq_dmod;  // BLTDMOD
+    uint16_t bq_adat;  // BLTADAT
+    uint16_t bq_bdat;  // BLTBDAT
+    uint16_t bq_size;  // BLTSIZE (written last, which starts the blit)
+    uint16_t bq_unused;
+    uint32_t bq_apt;   // BLTAPT
+    uint32_t bq_bpt;   // BLTBPT
+    uint32_t bq_cpt;   // BLTCPT
+    uint32_t bq_dpt;   // BLTDPT
+} blit_t;
+
+/* Blitter queue */
+void blit_queue_add(const blit_t *b);
+void blit_queue_irq(void);
+uint blit_queue_mark(void);
+void blit_queue_wait(uint mark);
+
 /* Primitives */
 void draw_test(void);
 void draw_line(uint fgpen, int x1, int y1, int x2, int y2);
@@ -60,6 +86,8 @@ void fill_rect_blit(uint fgpen, uint x1, uint y1, uint x2, uint y2,
 void gray_rect(uint fgpen, uint x1, uint y1, uint x2, uint y2);
 void blit_fill(APTR dst_base, UWORD dst_stride_b, UWORD x, UWORD y,
                UWORD width, UWORD height);
+uint blit_text(const uint8_t *src, uint src_stride, uint len, uint x, uint y,
+               uint fg_color, uint bg_color);
 
 void     Move(RastPort *rp, int x, int y);
 void     Draw(RastPort *rp, int x, int y);
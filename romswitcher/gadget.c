@@ -27,8 +27,10 @@
 #include "serial.h"
 #include "timer.h"
 #include "main.h"
+#include "vectors.h"
 
 static void GT_PutIMsg(IntuiMessage *imsg);
+static void gadget_damage(Gadget *gad);
 
 static Gadget *mouse_cur_gadget = NULL;
 static Gadget *click_cur_gadget = NULL;
@@ -597,12 +599,12 @@ gadget_update_mx_mouse(Gadget *gad)
     MxInfo *mx = gad->SpecialInfo;
     if (mx != NULL) {
         uint sel_height = mx->mx_sel_height + mx->mx_spacing;
-        uint yoff = mouse_y - gad->TopEdge;
+        uint yoff = mouse_ev_y - gad->TopEdge;
         uint newsel = yoff / sel_height;
 // printf("sh=%u,yo=%u,nsel=%u", sel_height, yoff, newsel);
         if (mx->mx_seldisplay != newsel) {
             mx->mx_seldisplay = newsel;
-            gadget_update_mx(gad);  // update selection
+            gadget_damage(gad);  // update selection at next frame
         }
     }
 }
@@ -654,7 +656,7 @@ gadget_update_string_mouse(Gadget *gad)
 {
     StringInfo *si = gad->SpecialInfo;
 
-    cursor_x = (mouse_x - cursor_x_start) / FONT_WIDTH;
+    cursor_x = (mouse_ev_x - cursor_x_start) / FONT_WIDTH;
     if (si != NULL) {
         uint len = strlen(si->Buffer);
         if (cursor_x > len)
@@ -749,6 +751,237 @@ gadget_draw_text(Gadget *gad)
         gadget_draw_bounding_box(gad, BBFT_RIDGE, FALSE);
 }
 
+/*
+ * Damage tracking
+ *
+ * Gadget state changes caused by mouse movement and clicks don't redraw
+ * the gadget immediately. Instead, the gadget's area is recorded as
+ * damaged. Overlapping damaged areas are merged, and all gadgets which
+ * intersect a damaged area are redrawn once per frame, just after the
+ * vertical blank. This coalesces the redraws caused by several hover
+ * changes within the same frame.
+ *
+ * The button and MX selection state at the time of damage is also
+ * queued, so that a state which is replaced before the next frame (such
+ * as a quick press and release) is still drawn for one frame.
+ */
+#define DAMAGE_MAX 8
+static Rectangle damage[DAMAGE_MAX];
+static uint      damage_count;
+static uint      damage_frame;  // vblank_count at last redraw
+
+typedef struct {
+    Gadget  *ds_gad;
+    uint16_t ds_flags;      // GFLG_SELECTED at time of damage
+    uint8_t  ds_mxsel;      // mx_seldisplay at time of damage
+} damage_state_t;
+
+#define DAMAGE_STATE_MAX 8
+static damage_state_t damage_state[DAMAGE_STATE_MAX];
+static uint           damage_state_count;
+
+static uint
+rect_overlaps(const Rectangle *a, const Rectangle *b)
+{
+    return ((a->MinX <= b->MaxX) && (b->MinX <= a->MaxX) &&
+            (a->MinY <= b->MaxY) && (b->MinY <= a->MaxY));
+}
+
+static void
+rect_merge(Rectangle *dst, const Rectangle *src)
+{
+    if (dst->MinX > src->MinX)
+        dst->MinX = src->MinX;
+    if (dst->MinY > src->MinY)
+        dst->MinY = src->MinY;
+    if (dst->MaxX < src->MaxX)
+        dst->MaxX = src->MaxX;
+    if (dst->MaxY < src->MaxY)
+        dst->MaxY = src->MaxY;
+}
+
+/*
+ * gadget_damage_rect() adds the specified rectangle to the list of
+ * areas needing redraw, merging it with any areas which it overlaps.
+ */
+static void
+gadget_damage_rect(const Rectangle *rect)
+{
+    Rectangle r = *rect;
+    uint cur;
+
+    /* Merging may cause the result to overlap other areas, so repeat */
+    for (cur = 0; cur < damage_count; ) {
+        if (rect_overlaps(&damage[cur], &r)) {
+            rect_merge(&r, &damage[cur]);
+            damage[cur] = damage[--damage_count];
+            cur = 0;
+        } else {
+            cur++;
+        }
+    }
+    if (damage_count == DAMAGE_MAX) {
+        /* List full: fold everything into the first entry */
+        for (cur = 1; cur < damage_count; cur++)
+            rect_merge(&damage[0], &damage[cur]);
+        rect_merge(&damage[0], &r);
+        damage_count = 1;
+        return;
+    }
+    damage[damage_count++] = r;
+}
+
+static void
+gadget_state_get(Gadget *gad, damage_state_t *ds)
+{
+    MxInfo *mx = gad->SpecialInfo;
+
+    ds->ds_gad   = gad;
+    ds->ds_flags = gad->Flags & GFLG_SELECTED;
+    ds->ds_mxsel = ((gad->GadgetType == MX_KIND) && (mx != NULL)) ?
+                   mx->mx_seldisplay : 0;
+}
+
+static void
+gadget_state_set(Gadget *gad, const damage_state_t *ds)
+{
+    MxInfo *mx = gad->SpecialInfo;
+
+    gad->Flags = (gad->Flags & ~GFLG_SELECTED) | ds->ds_flags;
+    if ((gad->GadgetType == MX_KIND) && (mx != NULL))
+        mx->mx_seldisplay = ds->ds_mxsel;
+}
+
+/*
+ * gadget_damage() marks the area of the specified gadget for redraw
+ * at the next frame, and queues its current selection state if that
+ * differs from the last state queued for the gadget.
+ */
+static void
+gadget_damage(Gadget *gad)
+{
+    Rectangle      r;
+    damage_state_t ds;
+    int            cur;
+
+    if (gad == NULL)
+        return;
+    r.MinX = gad->LeftEdge;
+    r.MinY = gad->TopEdge;
+    r.MaxX = gad->LeftEdge + gad->Width - 1;
+    r.MaxY = gad->TopEdge + gad->Height - 1;
+    gadget_damage_rect(&r);
+
+    if ((gad->GadgetType != BUTTON_KIND) && (gad->GadgetType != MX_KIND))
+        return;
+    gadget_state_get(gad, &ds);
+    for (cur = damage_state_count - 1; cur >= 0; cur--) {
+        if (damage_state[cur].ds_gad == gad) {
+            if ((damage_state[cur].ds_flags == ds.ds_flags) &&
+                (damage_state[cur].ds_mxsel == ds.ds_mxsel)) {
+                return;  // Already queued
+            }
+            break;
+        }
+    }
+    if (damage_state_count < DAMAGE_STATE_MAX)
+        damage_state[damage_state_count++] = ds;
+    /* Otherwise the gadget's current state is drawn when it is reached */
+}
+
+/*
+ * gadget_redraw_state() redraws those parts of a gadget which reflect
+ * its current hover / selection state.
+ */
+static void
+gadget_redraw_state(Gadget *gad)
+{
+    switch (gad->GadgetType) {
+        case BUTTON_KIND:
+            gadget_draw_button(gad, !!(gad->Flags & GFLG_SELECTED));
+            break;
+        case MX_KIND:
+            gadget_update_mx(gad);
+            break;
+        case STRING_KIND:
+        case INTEGER_KIND:
+            gadget_update_string(gad, GADGET_STRING_UPDATE_ALL);
+            break;
+        case TEXT_KIND:
+        case NUMBER_KIND:
+            gadget_draw_text(gad);
+            break;
+    }
+}
+
+/*
+ * gadget_damage_redraw() redraws every gadget which intersects a damaged
+ * area. It does nothing until the next vertical blank since the last
+ * redraw, so that each gadget is drawn at most once per frame.
+ *
+ * A gadget with queued states is drawn in the oldest of them. If more
+ * states remain queued for that gadget, it is damaged again so that the
+ * next state is drawn in the following frame.
+ */
+void
+gadget_damage_redraw(void)
+{
+    GadContext *gc;
+    Gadget     *gad;
+    uint        frame = vblank_count;
+    uint        cur;
+
+    if ((damage_count == 0) || (frame == damage_frame))
+        return;
+    damage_frame = frame;
+
+    for (gc = gad_context_head; gc != NULL; gc = gc->gc_next) {
+        for (gad = gc->gc_Gadget.NextGadget; gad != NULL;
+             gad = gad->NextGadget) {
+            Rectangle r;
+            r.MinX = gad->LeftEdge;
+            r.MinY = gad->TopEdge;
+            r.MaxX = gad->LeftEdge + gad->Width - 1;
+            r.MaxY = gad->TopEdge + gad->Height - 1;
+            for (cur = 0; cur < damage_count; cur++) {
+                if (rect_overlaps(&damage[cur], &r))
+                    break;
+            }
+            if (cur == damage_count)
+                continue;  // Not damaged
+
+            for (cur = 0; cur < damage_state_count; cur++)
+                if (damage_state[cur].ds_gad == gad)
+                    break;
+            if (cur < damage_state_count) {
+                /* Draw the oldest queued state, then drop it */
+                damage_state_t now;
+                gadget_state_get(gad, &now);
+                gadget_state_set(gad, &damage_state[cur]);
+                gadget_redraw_state(gad);
+                gadget_state_set(gad, &now);
+                damage_state_count--;
+                for (; cur < damage_state_count; cur++)
+                    damage_state[cur] = damage_state[cur + 1];
+            } else {
+                gadget_redraw_state(gad);
+            }
+        }
+    }
+    damage_count = 0;
+
+    /* Gadgets with further queued states are redrawn next frame */
+    for (cur = 0; cur < damage_state_count; cur++) {
+        Rectangle r;
+        gad = damage_state[cur].ds_gad;
+        r.MinX = gad->LeftEdge;
+        r.MinY = gad->TopEdge;
+        r.MaxX = gad->LeftEdge + gad->Width - 1;
+        r.MaxY = gad->TopEdge + gad->Height - 1;
+        gadget_damage_rect(&r);
+    }
+}
+
 static void
 gadget_notify(Gadget *gad, uint class, uint code, uint qual)
 {
@@ -1490,8 +1723,8 @@ gadget_poll(void)
 static void
 gadget_handle_click_hover(Gadget *gad, Gadget *oldgad, uint hover_type)
 {
-    int x = mouse_x;
-    int y = mouse_y;
+    int x = mouse_ev_x;
+    int y = mouse_ev_y;
     static IntuiMessage imsg;
     imsg.Class = 0;  // Default to not sent
 
@@ -1506,13 +1739,14 @@ gadget_handle_click_hover(Gadget *gad, Gadget *oldgad, uint hover_type)
         case HOVER_AWAY:  // Hovered away from gadget while mouse button held
             switch (gad->GadgetType) {
                 case BUTTON_KIND:
-                    gadget_draw_button(gad, 0);
+                    gad->Flags &= ~GFLG_SELECTED;
+                    gadget_damage(gad);
                     break;
                 case MX_KIND: {
                     MxInfo *mx = gad->SpecialInfo;
                     if (mx != NULL)
                         mx->mx_seldisplay = mx->mx_selected;
-                    gadget_update_mx(gad);  // update selection
+                    gadget_damage(gad);  // update selection
                     break;
                 }
             }
@@ -1520,7 +1754,8 @@ gadget_handle_click_hover(Gadget *gad, Gadget *oldgad, uint hover_type)
         case HOVER_ONTO:  // Hover back onto gadget while mouse button held
             switch (gad->GadgetType) {
                 case BUTTON_KIND:
-                    gadget_draw_button(gad, 1);
+                    gad->Flags |= GFLG_SELECTED;
+                    gadget_damage(gad);
                     break;
                 case STRING_KIND:
                 case INTEGER_KIND:
@@ -1542,7 +1777,8 @@ gadget_handle_click_hover(Gadget *gad, Gadget *oldgad, uint hover_type)
         case HOVER_CLICK:  // Mouse button clicked on gadget
             switch (gad->GadgetType) {
                 case BUTTON_KIND:
-                    gadget_draw_button(gad, 1);
+                    gad->Flags |= GFLG_SELECTED;
+                    gadget_damage(gad);
                     break;
                 case MX_KIND:
                     gadget_update_mx_mouse(gad);
@@ -1562,7 +1798,8 @@ gadget_handle_click_hover(Gadget *gad, Gadget *oldgad, uint hover_type)
         case HOVER_RELEASE:  // Mouse button released on gadget prev. clicked
             switch (gad->GadgetType) {
                 case BUTTON_KIND:
-                    gadget_draw_button(gad, 0);
+                    gad->Flags &= ~GFLG_SELECTED;
+                    gadget_damage(gad);
                     break;
                 case STRING_KIND:
                 case INTEGER_KIND:
@@ -345,6 +345,7 @@ typedef struct MxInfo {
 void test_gadget(void);
 void gadget_mouse_move(int x, int y);
 void gadget_mouse_button(uint button, uint button_down);
+void gadget_damage_redraw(void);
 void show_gadlist(Gadget *gad_list);
 
 /* Amiga Exec API */
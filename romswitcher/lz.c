@@ -0,0 +1,82 @@
+/*
+ * LZ decompression of ROM-resident data.
+ *
+ * This source file is part of the code base for a simple Amiga ROM
+ * replacement sufficient to allow programs using some parts of GadTools
+ * to function.
+ *
+ * Copyright 2025 Chris Hooper. This program and source may be used
+ * and distributed freely, for any purpose which benefits the Amiga
+ * community. All redistributions must retain this Copyright notice.
+ *
+ * DISCLAIMER: THE SOFTWARE IS PROVIDED "AS-IS", WITHOUT ANY WARRANTY.
+ * THE AUTHOR ASSUMES NO LIABILITY FOR ANY DAMAGE ARISING OUT OF THE USE
+ * OR MISUSE OF THIS UTILITY OR INFORMATION REPORTED BY THIS UTILITY.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "util.h"
+#include "lz.h"
+
+static uint32_t
+get32(const uint8_t *src)
+{
+    return ((src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3]);
+}
+
+/*
+ * lz_unpack
+ * ---------
+ * Unpack a compressed block to dst, returning the unpacked length, or
+ * 0 if src does not hold a compressed block. This runs before globals are
+ * set up, so it must not use any.
+ */
+uint32_t
+lz_unpack(void *dst, const void *src)
+{
+    const uint8_t *sptr = src;
+    uint8_t       *dptr = dst;
+    uint8_t       *dend;
+    uint32_t       len;
+
+    if (get32(sptr) != LZ_MAGIC)
+        return (0);
+    len  = get32(sptr + 4);
+    dend = dptr + len;
+    sptr += LZ_HDR_SIZE;
+
+    while (1) {
+        const uint8_t *match;
+        uint           token = *sptr++;
+        uint           count = token >> 4;
+        uint8_t        ext;
+
+        if (count == 15) {
+            do {
+                ext = *sptr++;
+                count += ext;
+            } while (ext == 255);
+        }
+        memcpy(dptr, sptr, count);
+        dptr += count;
+        sptr += count;
+        if (dptr >= dend)
+            break;
+
+        match = dptr - ((sptr[0] << 8) | sptr[1]);
+        sptr += 2;
+        count = token & 15;
+        if (count == 15) {
+            do {
+                ext = *sptr++;
+                count += ext;
+            } while (ext == 255);
+        }
+        count += LZ_MIN_MATCH;
+
+        /* Matches may overlap the output, so copy bytes in order */
+        while (count-- > 0)
+            *dptr++ = *match++;
+    }
+    return (len);
+}
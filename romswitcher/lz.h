@@ -0,0 +1,40 @@
+/*
+ * LZ decompression of ROM-resident data.
+ *
+ * This header file is part of the code base for a simple Amiga ROM
+ * replacement sufficient to allow programs using some parts of GadTools
+ * to function.
+ *
+ * Copyright 2025 Chris Hooper. This program and source may be used
+ * and distributed freely, for any purpose which benefits the Amiga
+ * community. All redistributions must retain this Copyright notice.
+ *
+ * DISCLAIMER: THE SOFTWARE IS PROVIDED "AS-IS", WITHOUT ANY WARRANTY.
+ * THE AUTHOR ASSUMES NO LIABILITY FOR ANY DAMAGE ARISING OUT OF THE USE
+ * OR MISUSE OF THIS UTILITY OR INFORMATION REPORTED BY THIS UTILITY.
+ */
+#ifndef _LZ_H
+#define _LZ_H
+
+/*
+ * Compressed block format, produced by dehunk -z
+ *
+ *   Header   "LZR1", then big-endian 32-bit unpacked and packed lengths
+ *   Sequence Token byte: bits 7-4 literal count, bits 3-0 match length
+ *            minus LZ_MIN_MATCH. A nibble of 15 is extended by following
+ *            bytes which are added until one is less than 255.
+ *            Literal bytes.
+ *            Big-endian 16-bit match offset back from the output position,
+ *            then any match length extension bytes.
+ *
+ * The final sequence has only literals, and ends at the unpacked length.
+ * Decoding is byte-oriented with no bit buffer, so it is fast on 68000.
+ */
+#define LZ_MAGIC        0x4c5a5231  // "LZR1"
+#define LZ_HDR_SIZE     12
+#define LZ_MIN_MATCH    3
+#define LZ_MAX_OFFSET   0xffff
+
+uint32_t lz_unpack(void *dst, const void *src);
+
+#endif /* _LZ_H */
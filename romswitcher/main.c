@@ -23,6 +23,8 @@
 #include "med_readline.h"
 #include "cpu_control.h"
 #include "mouse.h"
+#include "intuition.h"
+#include "gadget.h"
 #include "autoconfig.h"
 #include "testdraw.h"
 #include "testgadget.h"
@@ -34,6 +36,7 @@
 #include "util.h"
 #include "vectors.h"
 #include "main.h"
+#include "lz.h"
 
 /*
  * Memory map
@@ -117,7 +120,9 @@ globals_init(void)
     /* Set up globals (compile with -fbaserel for a5 is global pointer) */
     uint8_t *globals = (uint8_t *) (GLOBALS_BASE);  // Globals begin at 64K
 
-    memcpy(globals, data_start, data_size);
+    /* dehunk -z may have compressed the data image */
+    if (lz_unpack(globals, data_start) == 0)
+        memcpy(globals, data_start, data_size);
     memset(globals + data_size, 0, bss_size);
 
     globals += 0x7ffe;  // offset that gcc applies to a4-relative globals
@@ -146,18 +151,87 @@ reset_hi(void)
     __asm("jmp _setup");  // setup()
 }
 
+/*
+ * boot_hsync_start
+ * ----------------
+ * Reset the CIA-B event counter, which counts horizontal sync pulses,
+ * so that it can be used to measure time since boot before timer_init()
+ * has calibrated the E clock.
+ */
+static void
+boot_hsync_start(void)
+{
+    *CIAB_EMSB = 0;  // Stops the counter
+    *CIAB_EMID = 0;
+    *CIAB_ELSB = 0;  // Starts the counter
+}
+
+/*
+ * boot_hsync_lines
+ * ----------------
+ * Return the number of horizontal sync pulses since boot_hsync_start().
+ */
+static uint32_t
+boot_hsync_lines(void)
+{
+    /* Reading the MSB latches the counter until the LSB is read */
+    uint32_t lines = *CIAB_EMSB << 16;
+    lines |= *CIAB_EMID << 8;
+    lines |= *CIAB_ELSB;
+    return (lines);
+}
+
+/*
+ * boot_hsync_msec
+ * ---------------
+ * Return the number of milliseconds since boot_hsync_start().
+ */
+static uint
+boot_hsync_msec(void)
+{
+    /* PAL hsync is 15625 Hz, NTSC hsync is 15734 Hz */
+    return (boot_hsync_lines() * 64 / ((vid_type == VID_PAL) ? 1000 : 1007));
+}
+
+static uint32_t boot_globals_lines;  // Time taken by globals_init()
+
+/*
+ * main_deferred_init
+ * ------------------
+ * Start the audio boot chime, which takes noticeable time to set up and
+ * isn't needed to show the bank selection UI. This is called from the
+ * idle loop, after the UI has been drawn.
+ */
+static void
+main_deferred_init(void)
+{
+    static uint8_t deferred_done;
+
+    if (deferred_done)
+        return;
+    deferred_done = 1;
+
+    audio_init();  // Boot chime
+}
+
 void
 main_poll()
 {
+    main_deferred_init();
     cmdline();
-    mouse_poll();     // handle mouse buttons
+    mouse_poll();     // deliver queued mouse events
     keyboard_poll();  // handle key repeats
+    gadget_damage_redraw();  // redraw gadgets changed since last frame
 }
 
 void __attribute__ ((noinline))
 setup(void)
 {
+    char buf[64];
+
+    boot_hsync_start();
     globals_init();
+    boot_globals_lines = boot_hsync_lines();
     vectors_init((void *)VECTORS_BASE);
     memset(ADDR8(0), 0xa5, 0x100);  // Help catch NULL pointer usage
     cpu_control_init();  // Get CPU type
@@ -174,7 +248,6 @@ setup(void)
 //  dbg_show_string(RomID);
 
     timer_init();
-    audio_init();
     serial_puts("\bF");
 //  serial_init();  // Now that ECLK is known
     keyboard_init();
@@ -186,12 +259,16 @@ setup(void)
     autoconfig_init();
     serial_puts("\bJ");
 
+    /* Audio is initialized by main_poll(), once the UI is shown */
     gui_wants_all_input = 1;
     rl_initialize();
     using_history();
     serial_puts("\n");
     test_draw();
     test_gadget();
+    snprintf(buf, sizeof (buf), "Boot: %u ms (globals %u lines)\n",
+             boot_hsync_msec(), boot_globals_lines);
+    serial_puts(buf);
 #ifdef STANDALONE
     extern void main_func(void);
     main_func();
@@ -115,9 +115,9 @@ const char cmd_test_help[] =
 "   q = quad (8 bytes)\n"
 "   o = oct (16 bytes)\n"
 "   h = hex (32 bytes)\n"
-"   <mode> may be one, zero, rand, walk0, or walk1\n";
+"   <mode> may be one, zero, rand, walk0, walk1, march, or a value\n";
 const char cmd_test_patterns[] =
-    "<mode> may be one, zero, rand, walk0, or walk1\n";
+    "<mode> may be one, zero, rand, walk0, walk1, march, or a value\n";
 
 const char cmd_time_help[] =
 "time cmd <cmd> - measure command execution time\n"
@@ -189,6 +189,40 @@ data_write(uint64_t space, uint64_t addr, uint width, void *buf)
     }
 }
 
+/*
+ * Memory commands use the mem_*_block() functions instead of data_read()
+ * and data_write() when they operate on plain memory with longword or
+ * wider accesses and everything is longword aligned. Work is done in
+ * chunks of FAST_CHUNK bytes, so that ^C is still checked regularly.
+ */
+#define FAST_CHUNK 0x10000
+
+static bool_t
+fast_path_ok(uint64_t space, uint64_t addr, uint len, uint width)
+{
+    if (((uint8_t) space != SPACE_MEMORY) || (width < 4))
+        return (FALSE);
+    if (((addr | len) & 3) || (len % width))
+        return (FALSE);
+    if (addr + len > 0x100000000ULL)
+        return (FALSE);
+    return (TRUE);
+}
+
+/*
+ * Expand a width-byte element, which begins at addr, into the 32-byte
+ * address-indexed pattern used by mem_fill_block() and mem_verify_block().
+ */
+static void
+fast_pattern(uint32_t *pattern, const uint8_t *buf, uint width, uint64_t addr)
+{
+    uint8_t *pat = (uint8_t *) pattern;
+    uint     pos;
+
+    for (pos = 0; pos < 32; pos++)
+        pat[pos] = buf[(pos - (uint) addr) & (width - 1)];
+}
+
 void
 print_addr(uint64_t space, uint64_t addr)
 {
@@ -582,6 +616,7 @@ cmd_comp(int argc, char * const *argv)
     uint8_t     buf2[MAX_TRANSFER];
     bool_t      printed = FALSE;
     bool_t      flag_A = FALSE;
+    bool_t      fast;
     const char *cmd;
     const char *ptr;
     uint        mismatch_count = 0;
@@ -622,7 +657,32 @@ cmd_comp(int argc, char * const *argv)
     if ((rc = parse_uint(argv[0], &len)) != RC_SUCCESS)
         return (RC_USER_HELP);
 
-    for (offset = 0; offset < len; offset += width) {
+    fast = fast_path_ok(space1, addr1, len, width) &&
+           fast_path_ok(space2, addr2, len, width);
+
+    offset = 0;
+    while (offset < len) {
+        if (fast) {
+            /* Skip the matching run; mismatches are reported below */
+            uint chunk = len - offset;
+            uint good;
+            if (chunk > FAST_CHUNK)
+                chunk = FAST_CHUNK;
+            rc = mem_compare_block(addr1 + offset, addr2 + offset, chunk,
+                                   &good);
+            if (rc != RC_SUCCESS) {
+                fast = FALSE;  // Let the generic path locate the fault
+            } else {
+                offset += good - (good % width);
+                if (good == chunk) {
+                    if (input_break_pending()) {
+                        printf("^C\n");
+                        return (RC_USR_ABORT);
+                    }
+                    continue;
+                }
+            }
+        }
         rc = data_read(space1, addr1 + offset, width, buf1);
         if (rc != RC_SUCCESS) {
             if (printed)
@@ -656,6 +716,7 @@ cmd_comp(int argc, char * const *argv)
                 printf("\n");
             }
         }
+        offset += width;
         if (input_break_pending()) {
             printf("^C\n");
             return (RC_USR_ABORT);
@@ -679,6 +740,7 @@ cmd_copy(int argc, char * const *argv)
     uint64_t    dspace;
     uint        len;
     uint        offset;
+    uint        chunk;
     char        other[32];
     uint8_t     buf[MAX_TRANSFER];
     const char *cmd;
@@ -708,7 +770,26 @@ cmd_copy(int argc, char * const *argv)
     if ((rc = parse_uint(argv[0], &len)) != RC_SUCCESS)
         return (RC_USER_HELP);
 
-    for (offset = 0; offset < len; offset += width) {
+    offset = 0;
+    if (fast_path_ok(sspace, saddr, len, width) &&
+        fast_path_ok(dspace, daddr, len, width) &&
+        ((saddr + len <= daddr) || (daddr + len <= saddr))) {
+        for (; offset < len; offset += chunk) {
+            chunk = len - offset;
+            if (chunk > FAST_CHUNK)
+                chunk = FAST_CHUNK;
+            if (mem_copy_block(daddr + offset, saddr + offset, chunk) !=
+                RC_SUCCESS) {
+                break;  // Let the generic path locate the fault
+            }
+            if (input_break_pending()) {
+                printf("^C\n");
+                return (RC_USR_ABORT);
+            }
+        }
+    }
+
+    for (; offset < len; offset += width) {
         rc = data_read(sspace, saddr + offset, width, buf);
         if (rc != RC_SUCCESS) {
             printf("Error reading %d bytes at ", width);
@@ -1296,7 +1377,27 @@ show_patterns:
         pattmode = PATT_VALUE;
     }
 
-    for (offset = 0; offset < len; offset += width) {
+    offset = 0;
+    if (((pattmode == PATT_ONE) || (pattmode == PATT_ZERO) ||
+         (pattmode == PATT_VALUE)) && fast_path_ok(space, addr, len, width)) {
+        uint32_t pattern[8];
+        uint     chunk;
+
+        fast_pattern(pattern, buf, width, addr);
+        for (; offset < len; offset += chunk) {
+            chunk = len - offset;
+            if (chunk > FAST_CHUNK)
+                chunk = FAST_CHUNK;
+            if (mem_fill_block(addr + offset, pattern, chunk) != RC_SUCCESS)
+                break;  // Let the generic path locate the fault
+            if (input_break_pending()) {
+                printf("^C\n");
+                return (RC_USR_ABORT);
+            }
+        }
+    }
+
+    for (; offset < len; offset += width) {
         switch (pattmode) {
             case PATT_WALK0: {
                 int pos  = (step >> 3) & (width - 1);
@@ -1374,6 +1475,143 @@ show_patterns:
     return (RC_SUCCESS);
 }
 
+/*
+ * Write then verify a constant pattern over aligned memory, one chunk
+ * at a time.
+ */
+static rc_t
+test_fast_fill(uint64_t addr, uint len, const uint32_t *pattern)
+{
+    uint offset;
+    uint chunk;
+    uint good;
+    uint more;
+    uint mismatch_count = 0;
+
+    for (offset = 0; offset < len; offset += chunk) {
+        rc_t rc;
+        chunk = len - offset;
+        if (chunk > FAST_CHUNK)
+            chunk = FAST_CHUNK;
+        rc = mem_fill_block(addr + offset, pattern, chunk);
+        if (rc == RC_SUCCESS)
+            rc = mem_verify_block(addr + offset, pattern, chunk, &good);
+        while ((rc == RC_SUCCESS) && (good < chunk)) {
+            uint32_t bad = addr + offset + good;
+            uint32_t data;
+            if ((mismatch_count++ < 8) &&
+                (mem_read(bad, 4, &data) == RC_SUCCESS)) {
+                printf("mismatch ");
+                print_addr(SPACE_MEMORY, bad);
+                printf(" %08x != %08x\n", data, pattern[(bad >> 2) & 7]);
+            }
+            rc = mem_verify_block(bad + 4, pattern, chunk - good - 4, &more);
+            good += 4 + more;
+        }
+        if (rc != RC_SUCCESS) {
+            printf("Error accessing %u bytes at ", chunk);
+            print_addr(SPACE_MEMORY, addr + offset);
+            printf("\n");
+            return (rc);
+        }
+        if (input_break_pending()) {
+            printf("^C\n");
+            return (RC_USR_ABORT);
+        }
+    }
+    if (mismatch_count > 0) {
+        printf("%u mismatches\n", mismatch_count);
+        return (RC_FAILURE);
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * March C- (10n): each element walks all cells in the given direction,
+ * reading and/or writing the data background (D) or its complement (~D).
+ *     up(w D) up(r D,w ~D) up(r ~D,w D) down(r D,w ~D) down(r ~D,w D) (r D)
+ */
+static const struct {
+    uint8_t me_flags;      // MEM_MARCH_* flags
+    uint8_t me_read_inv;   // Expect ~D
+    uint8_t me_write_inv;  // Write ~D
+} march_c_minus[] = {
+    { MEM_MARCH_WRITE,                                  0, 0 },
+    { MEM_MARCH_READ | MEM_MARCH_WRITE,                 0, 1 },
+    { MEM_MARCH_READ | MEM_MARCH_WRITE,                 1, 0 },
+    { MEM_MARCH_READ | MEM_MARCH_WRITE | MEM_MARCH_DOWN, 0, 1 },
+    { MEM_MARCH_READ | MEM_MARCH_WRITE | MEM_MARCH_DOWN, 1, 0 },
+    { MEM_MARCH_READ,                                   0, 0 },
+};
+
+/*
+ * Data backgrounds for a word-oriented March test: solid, followed by
+ * each power-of-two stripe, which exposes coupling between bits of
+ * the same longword.
+ */
+static const uint32_t march_backgrounds[] = {
+    0x00000000, 0x55555555, 0x33333333, 0x0f0f0f0f, 0x00ff00ff, 0x0000ffff
+};
+
+static rc_t
+test_march(uint64_t addr, uint len)
+{
+    uint bg;
+    uint elem;
+    uint mismatch_count = 0;
+
+    for (bg = 0; bg < ARRAY_SIZE(march_backgrounds); bg++) {
+        uint32_t d = march_backgrounds[bg];
+        for (elem = 0; elem < ARRAY_SIZE(march_c_minus); elem++) {
+            uint     flags  = march_c_minus[elem].me_flags;
+            uint32_t expect = march_c_minus[elem].me_read_inv ? ~d : d;
+            uint32_t value  = march_c_minus[elem].me_write_inv ? ~d : d;
+            uint     done;
+
+            /* Descending elements process their chunks top down */
+            for (done = 0; done < len; ) {
+                mem_march_fail_t fail;
+                uint     chunk = len - done;
+                uint64_t base;
+                rc_t     rc;
+                if (chunk > FAST_CHUNK)
+                    chunk = FAST_CHUNK;
+                if (flags & MEM_MARCH_DOWN)
+                    base = addr + len - done - chunk;
+                else
+                    base = addr + done;
+                rc = mem_march_element(base, chunk, flags, expect, value,
+                                       &fail);
+                if (rc != RC_SUCCESS) {
+                    printf("Error accessing %u bytes at ", chunk);
+                    print_addr(SPACE_MEMORY, base);
+                    printf("\n");
+                    return (rc);
+                }
+                if ((fail.mf_count != 0) && (mismatch_count < 8)) {
+                    printf("march bg %08x M%u: ", d, elem);
+                    print_addr(SPACE_MEMORY, fail.mf_addr);
+                    printf(" %08x != %08x", fail.mf_data, expect);
+                    if (fail.mf_count > 1)
+                        printf(" (+%u more in block)", fail.mf_count - 1);
+                    printf("\n");
+                }
+                mismatch_count += fail.mf_count;
+                done += chunk;
+                if (input_break_pending()) {
+                    printf("^C\n");
+                    return (RC_USR_ABORT);
+                }
+            }
+        }
+    }
+    if (mismatch_count > 0) {
+        printf("%u mismatches\n", mismatch_count);
+        return (RC_FAILURE);
+    }
+    return (RC_SUCCESS);
+}
+
 rc_t
 cmd_test(int argc, char * const *argv)
 {
@@ -1396,6 +1634,7 @@ cmd_test(int argc, char * const *argv)
         TEST_RAND,
         TEST_WALK0,
         TEST_WALK1,
+        TEST_MARCH,
     } testmode = TEST_VALUE;
     static enum {
         RWMODE_READ,
@@ -1454,6 +1693,8 @@ show_patterns:
         } else if (strcmp(argv[0], "zero") == 0) {
             testmode = TEST_ZERO;
             memset(buf, 0x00, width);
+        } else if (strcmp(argv[0], "march") == 0) {
+            testmode = TEST_MARCH;
         } else {
             testmode = TEST_VALUE;
             if ((rc = parse_value(argv[0], buf, width)) != RC_SUCCESS) {
@@ -1465,6 +1706,21 @@ show_patterns:
         rwmode = RWMODE_READ;
     }
 
+    if ((rwmode == RWMODE_WRITE) && (testmode == TEST_MARCH)) {
+        if (!fast_path_ok(space, addr, len, 4)) {
+            printf("march requires longword aligned memory\n");
+            return (RC_FAILURE);
+        }
+        return (test_march(addr, len));
+    }
+    if ((rwmode == RWMODE_WRITE) &&
+        ((testmode == TEST_ONE) || (testmode == TEST_ZERO) ||
+         (testmode == TEST_VALUE)) && fast_path_ok(space, addr, len, width)) {
+        uint32_t pattern[8];
+        fast_pattern(pattern, buf, width, addr);
+        return (test_fast_fill(addr, len, pattern));
+    }
+
     for (offset = 0; offset < len; offset += width) {
         count++;
         if (rwmode == RWMODE_WRITE) {
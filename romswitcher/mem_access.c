@@ -14,6 +14,7 @@
 #endif
 #include "med_cmdline.h"
 #include "mem_access.h"
+#include "cpu_control.h"
 
 #if 0
 #if defined(AMIGA)
@@ -270,3 +271,250 @@ wmode_16:
 
     return (RC_SUCCESS);
 }
+
+/*
+ * Block operations for the memory commands
+ *
+ * These bypass the per-access width dispatch of mem_read() and mem_write()
+ * for plain memory. Addresses and lengths must be longword aligned.
+ * Patterns are 32 bytes, indexed by address bits 2-4, so that an operation
+ * may be split at any longword boundary and resumed.
+ */
+void mem_fill_movem(void *dst, const void *pattern, uint count);
+void mem_copy_movem(void *dst, const void *src, uint count);
+void mem_copy_move16(void *dst, const void *src, uint count);
+
+/*
+ * void mem_fill_movem(void *dst, const void *pattern, uint count)
+ *           Fill count 32-byte blocks at dst with the 32-byte pattern
+ */
+__asm("_mem_fill_movem: \n"
+      "movem.l d2-d7/a2,-(sp) \n"
+      "move.l 32(sp),a1 \n" //      ; a1 = dst
+      "move.l 36(sp),a0 \n" //      ; a0 = pattern
+      "move.l 40(sp),d7 \n" //      ; d7 = count
+      "movem.l (a0),d0-d6/a2 \n"
+      "bra.s mem_fill_movem_next \n"
+      "mem_fill_movem_loop: \n"
+      "movem.l d0-d6/a2,(a1) \n"
+      "lea 32(a1),a1 \n"
+      "mem_fill_movem_next: \n"
+      "subq.l #1,d7 \n"
+      "bcc.s mem_fill_movem_loop \n"
+      "movem.l (sp)+,d2-d7/a2 \n"
+      "rts");
+
+/*
+ * void mem_copy_movem(void *dst, const void *src, uint count)
+ *           Copy count 32-byte blocks from src to dst
+ */
+__asm("_mem_copy_movem: \n"
+      "movem.l d2-d7/a2,-(sp) \n"
+      "move.l 32(sp),a1 \n" //      ; a1 = dst
+      "move.l 36(sp),a0 \n" //      ; a0 = src
+      "move.l 40(sp),d7 \n" //      ; d7 = count
+      "bra.s mem_copy_movem_next \n"
+      "mem_copy_movem_loop: \n"
+      "movem.l (a0)+,d0-d6/a2 \n"
+      "movem.l d0-d6/a2,(a1) \n"
+      "lea 32(a1),a1 \n"
+      "mem_copy_movem_next: \n"
+      "subq.l #1,d7 \n"
+      "bcc.s mem_copy_movem_loop \n"
+      "movem.l (sp)+,d2-d7/a2 \n"
+      "rts");
+
+/*
+ * void mem_copy_move16(void *dst, const void *src, uint count)
+ *           Copy count 16-byte lines from src to dst (68040 and 68060 only)
+ */
+__asm("_mem_copy_move16: \n"
+      "move.l 4(sp),a1 \n"  //      ; a1 = dst
+      "move.l 8(sp),a0 \n"  //      ; a0 = src
+      "move.l 12(sp),d0 \n" //      ; d0 = count
+      "bra.s mem_copy_move16_next \n"
+      "mem_copy_move16_loop: \n"
+      "move16 (a0)+,(a1)+ \n"
+      "mem_copy_move16_next: \n"
+      "subq.l #1,d0 \n"
+      "bcc.s mem_copy_move16_loop \n"
+      "rts");
+
+/*
+ * rc_t mem_fill_block(uint32_t addr, const uint32_t *pattern, uint len)
+ *           Fill memory with a repeating 32-byte pattern
+ */
+rc_t
+mem_fill_block(uint32_t addr, const uint32_t *pattern, uint len)
+{
+    uint32_t *ptr = (uint32_t *)(uintptr_t) addr;
+    uint      count = len / 4;
+    uint      lead  = (8 - ((addr >> 2) & 7)) & 7;
+    uint      pos;
+
+    if (lead > count)
+        lead = count;
+
+    MEM_FAULT_CAPTURE;
+    mem_fault_count = 0;
+
+    /* Bring the destination to a 32-byte boundary, then fill with MOVEM */
+    for (pos = 0; pos < lead; pos++, ptr++)
+        *ptr = pattern[((uintptr_t) ptr >> 2) & 7];
+    count -= lead;
+    mem_fill_movem(ptr, pattern, count / 8);
+    ptr += count & ~7;
+    for (pos = 0; pos < (count & 7); pos++, ptr++)
+        *ptr = pattern[pos];
+
+    MEM_FAULT_RESTORE;
+    if (mem_fault_count != 0)
+        return (RC_FAILURE);
+
+    return (RC_SUCCESS);
+}
+
+/*
+ * rc_t mem_verify_block(uint32_t addr, const uint32_t *pattern, uint len,
+ *                       uint *good)
+ *           Compare memory against a repeating 32-byte pattern, returning
+ *           in good the byte count which matched before the first mismatch
+ */
+rc_t
+mem_verify_block(uint32_t addr, const uint32_t *pattern, uint len,
+                 uint *good)
+{
+    const volatile uint32_t *ptr = (uint32_t *)(uintptr_t) addr;
+    uint count = len / 4;
+    uint pos;
+
+    MEM_FAULT_CAPTURE;
+    mem_fault_count = 0;
+
+    for (pos = 0; pos < count; pos++, ptr++)
+        if (*ptr != pattern[((uintptr_t) ptr >> 2) & 7])
+            break;
+    *good = pos * 4;
+
+    MEM_FAULT_RESTORE;
+    if (mem_fault_count != 0)
+        return (RC_FAILURE);
+
+    return (RC_SUCCESS);
+}
+
+/*
+ * rc_t mem_copy_block(uint32_t daddr, uint32_t saddr, uint len)
+ *           Copy memory which does not overlap, using MOVE16 where the
+ *           CPU and alignment allow it, or else MOVEM
+ */
+rc_t
+mem_copy_block(uint32_t daddr, uint32_t saddr, uint len)
+{
+    uint32_t       *dst = (uint32_t *)(uintptr_t) daddr;
+    const uint32_t *src = (const uint32_t *)(uintptr_t) saddr;
+    uint            done;
+    uint            pos;
+
+    MEM_FAULT_CAPTURE;
+    mem_fault_count = 0;
+
+    if (((cpu_type == 68040) || (cpu_type == 68060)) &&
+        (((daddr | saddr) & 15) == 0)) {
+        done = len & ~15;
+        mem_copy_move16(dst, src, done / 16);
+    } else {
+        done = len & ~31;
+        mem_copy_movem(dst, src, done / 32);
+    }
+    dst += done / 4;
+    src += done / 4;
+    for (pos = 0; pos < (len - done) / 4; pos++)
+        dst[pos] = src[pos];
+
+    MEM_FAULT_RESTORE;
+    if (mem_fault_count != 0)
+        return (RC_FAILURE);
+
+    return (RC_SUCCESS);
+}
+
+/*
+ * rc_t mem_compare_block(uint32_t addr1, uint32_t addr2, uint len,
+ *                        uint *good)
+ *           Compare two memory ranges, returning in good the byte count
+ *           which matched before the first mismatch
+ */
+rc_t
+mem_compare_block(uint32_t addr1, uint32_t addr2, uint len, uint *good)
+{
+    const volatile uint32_t *ptr1 = (uint32_t *)(uintptr_t) addr1;
+    const volatile uint32_t *ptr2 = (uint32_t *)(uintptr_t) addr2;
+    uint count = len / 4;
+    uint pos = 0;
+
+    MEM_FAULT_CAPTURE;
+    mem_fault_count = 0;
+
+    /* Unrolled to amortize the loop overhead on 68000 */
+    while ((pos + 4 <= count) &&
+           (ptr1[pos] == ptr2[pos]) &&
+           (ptr1[pos + 1] == ptr2[pos + 1]) &&
+           (ptr1[pos + 2] == ptr2[pos + 2]) &&
+           (ptr1[pos + 3] == ptr2[pos + 3])) {
+        pos += 4;
+    }
+    while ((pos < count) && (ptr1[pos] == ptr2[pos]))
+        pos++;
+    *good = pos * 4;
+
+    MEM_FAULT_RESTORE;
+    if (mem_fault_count != 0)
+        return (RC_FAILURE);
+
+    return (RC_SUCCESS);
+}
+
+/*
+ * rc_t mem_march_element(uint32_t addr, uint len, uint flags,
+ *                        uint32_t expect, uint32_t value,
+ *                        mem_march_fail_t *fail)
+ *           Apply one March test element to each longword of the range,
+ *           ascending or descending: optionally verify that it reads as
+ *           expect, then optionally write value
+ */
+rc_t
+mem_march_element(uint32_t addr, uint len, uint flags, uint32_t expect,
+                  uint32_t value, mem_march_fail_t *fail)
+{
+    volatile uint32_t *ptr = (uint32_t *)(uintptr_t) addr;
+    uint count = len / 4;
+    int  step  = 1;
+
+    if (flags & MEM_MARCH_DOWN) {
+        ptr += count - 1;
+        step = -1;
+    }
+    fail->mf_count = 0;
+
+    MEM_FAULT_CAPTURE;
+    mem_fault_count = 0;
+
+    for (; count > 0; count--, ptr += step) {
+        if (flags & MEM_MARCH_READ) {
+            uint32_t data = *ptr;
+            if ((data != expect) && (fail->mf_count++ == 0)) {
+                fail->mf_addr = (uintptr_t) ptr;
+                fail->mf_data = data;
+            }
+        }
+        if (flags & MEM_MARCH_WRITE)
+            *ptr = value;
+    }
+
+    MEM_FAULT_RESTORE;
+    if (mem_fault_count != 0)
+        return (RC_FAILURE);
+
+    return (RC_SUCCESS);
+}
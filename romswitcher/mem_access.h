@@ -15,6 +15,25 @@
 rc_t mem_read(uint64_t addr, uint width, void *bufp);
 rc_t mem_write(uint64_t addr, uint width, void *bufp);
 
+/* mem_march_element() flags */
+#define MEM_MARCH_READ   0x01  // Verify each cell before any write
+#define MEM_MARCH_WRITE  0x02  // Write each cell
+#define MEM_MARCH_DOWN   0x04  // Descend from the top of the range
+
+typedef struct {
+    uint     mf_count;  // Cells which did not read as expected
+    uint32_t mf_addr;   // Address of the first failing cell
+    uint32_t mf_data;   // Value read from the first failing cell
+} mem_march_fail_t;
+
+rc_t mem_fill_block(uint32_t addr, const uint32_t *pattern, uint len);
+rc_t mem_verify_block(uint32_t addr, const uint32_t *pattern, uint len,
+                      uint *good);
+rc_t mem_copy_block(uint32_t daddr, uint32_t saddr, uint len);
+rc_t mem_compare_block(uint32_t addr1, uint32_t addr2, uint len, uint *good);
+rc_t mem_march_element(uint32_t addr, uint len, uint flags, uint32_t expect,
+                       uint32_t value, mem_march_fail_t *fail);
+
 extern uint8_t       mem_fault_ok;
 extern volatile uint mem_fault_count;
 
@@ -21,6 +21,7 @@
 #include "timer.h"
 #include "intuition.h"
 #include "gadget.h"
+#include "screen.h"
 #include "mouse.h"
 
 #define MOUSE_DEBUG
@@ -30,45 +31,152 @@
 #define DPRINTF(fmt, ...)
 #endif
 
-int mouse_x;
-int mouse_y;
-int mouse_x_last;
-int mouse_y_last;
+int  mouse_x;     // Pointer position, updated every vertical blank
+int  mouse_y;
+int  mouse_ev_x;  // Pointer position of the event being handled
+int  mouse_ev_y;
 uint mouse_left;
 uint mouse_right;
 
+/*
+ * Mouse events are queued by the vertical blank interrupt and consumed by
+ * mouse_poll() through gadget_poll(). There is a single producer and a
+ * single consumer, so no locking is needed: the interrupt only advances
+ * mouse_ev_prod and the main loop only advances mouse_ev_cons.
+ */
+#define MOUSE_EV_MOVE   0  // Pointer moved
+#define MOUSE_EV_BUTTON 1  // Button changed state
+
+typedef struct {
+    int16_t me_x;
+    int16_t me_y;
+    uint8_t me_type;    // MOUSE_EV_*
+    uint8_t me_button;  // MOUSE_BUTTON_*
+    uint8_t me_down;    // MOUSE_BUTTON_PRESS or MOUSE_BUTTON_RELEASE
+    uint8_t me_unused;
+} mouse_event_t;
+
+static mouse_event_t     mouse_ev_rb[32];
+static volatile uint8_t  mouse_ev_prod;
+static volatile uint8_t  mouse_ev_cons;
+static volatile uint8_t  mouse_ev_dropped;
+
 static void
-mouse_poll_buttons(void)
+mouse_ev_put(uint type, uint button, uint down)
 {
-    static uint8_t mouse_left_last;
-    static uint8_t mouse_right_last;
+    uint prod = mouse_ev_prod;
+    uint next = (prod + 1) % ARRAY_SIZE(mouse_ev_rb);
+    uint used = (prod - mouse_ev_cons) % ARRAY_SIZE(mouse_ev_rb);
+
+    /* Keep room for button events; motion is only sampled position */
+    if ((next == mouse_ev_cons) ||
+        ((type == MOUSE_EV_MOVE) && (used >= ARRAY_SIZE(mouse_ev_rb) / 2))) {
+        mouse_ev_dropped = 1;
+        return;
+    }
+    mouse_ev_rb[prod].me_x      = mouse_x;
+    mouse_ev_rb[prod].me_y      = mouse_y;
+    mouse_ev_rb[prod].me_type   = type;
+    mouse_ev_rb[prod].me_button = button;
+    mouse_ev_rb[prod].me_down   = down;
+    mouse_ev_prod = next;
+}
+
+/*
+ * mouse_vblank
+ * ------------
+ * Sample the mouse counters and buttons. This is called from the vertical
+ * blank interrupt, so the pointer sprite follows the mouse even while the
+ * main loop is busy drawing or waiting on a KickSmash command.
+ */
+void
+mouse_vblank(void)
+{
+    static uint16_t mouse_quad_last;
+    static uint8_t  mouse_left_last;
+    static uint8_t  mouse_right_last;
+    uint16_t mouse_quad_cur;
+    int8_t   move_x;
+    int8_t   move_y;
+    int      old_x = mouse_x;
+    int      old_y = mouse_y;
+
+    mouse_quad_cur = *VADDR16(JOY0DAT);  // mouse X and Y counters
+    move_x = (mouse_quad_cur & 0xff) - (mouse_quad_last & 0xff);
+    move_y = (mouse_quad_cur >> 8) - (mouse_quad_last >> 8);
+    mouse_x += move_x * 2;
+    mouse_y += move_y;
+    if (mouse_x < 0)
+        mouse_x = 0;
+    if (mouse_x > SCREEN_WIDTH - 1)
+        mouse_x = SCREEN_WIDTH - 1;
+    if (mouse_y < 0)
+        mouse_y = 0;
+    if (mouse_y > SCREEN_HEIGHT + 8)
+        mouse_y = SCREEN_HEIGHT + 8;
+    mouse_quad_last = mouse_quad_cur;
+    if ((mouse_x != old_x) || (mouse_y != old_y))
+        mouse_ev_put(MOUSE_EV_MOVE, 0, 0);
 
     mouse_left  = !(*CIAA_PRA & BIT(6));
     mouse_right = !(*POTGOR & BIT(10));
 //  mouse_middle = !!(*POTGOR & BIT(8));
     if (mouse_left_last != mouse_left) {
-//      printf(" LMB%u", mouse_left);
         mouse_left_last = mouse_left;
-        gadget_mouse_button(MOUSE_BUTTON_LEFT, mouse_left);
+        mouse_ev_put(MOUSE_EV_BUTTON, MOUSE_BUTTON_LEFT, mouse_left);
     }
     if (mouse_right_last != mouse_right) {
-//      printf(" RMB%u", mouse_right);
         mouse_right_last = mouse_right;
-        gadget_mouse_button(MOUSE_BUTTON_RIGHT, mouse_right);
+        mouse_ev_put(MOUSE_EV_BUTTON, MOUSE_BUTTON_RIGHT, mouse_right);
     }
 }
 
+/*
+ * mouse_poll
+ * ----------
+ * Deliver queued mouse events to the gadget code. Consecutive motion
+ * events are merged, so a slow consumer only sees the latest position
+ * before each button change.
+ */
 void
 mouse_poll(void)
 {
-    if ((mouse_x != mouse_x_last) || (mouse_y != mouse_y_last)) {
-        /* Mouse moved -- check for gadget hover change */
-        gadget_mouse_move(mouse_x, mouse_y);
-        mouse_x_last = mouse_x;
-        mouse_y_last = mouse_y;
-//      printf("Mouse %x %x\n", mouse_x, mouse_y);
+    static int x_last = -1;
+    static int y_last = -1;
+
+    while (mouse_ev_cons != mouse_ev_prod) {
+        uint           cons = mouse_ev_cons;
+        uint           next = (cons + 1) % ARRAY_SIZE(mouse_ev_rb);
+        mouse_event_t *ev = &mouse_ev_rb[cons];
+
+        if ((ev->me_type == MOUSE_EV_MOVE) && (next != mouse_ev_prod) &&
+            (mouse_ev_rb[next].me_type == MOUSE_EV_MOVE)) {
+            mouse_ev_cons = next;  // Superseded by a later position
+            continue;
+        }
+        mouse_ev_x = ev->me_x;
+        mouse_ev_y = ev->me_y;
+        if ((mouse_ev_x != x_last) || (mouse_ev_y != y_last)) {
+            /* Mouse moved -- check for gadget hover change */
+            gadget_mouse_move(mouse_ev_x, mouse_ev_y);
+            x_last = mouse_ev_x;
+            y_last = mouse_ev_y;
+        }
+        if (ev->me_type == MOUSE_EV_BUTTON)
+            gadget_mouse_button(ev->me_button, ev->me_down);
+        mouse_ev_cons = next;
+    }
+    if (mouse_ev_dropped) {
+        /* Queue overflowed; resynchronize with the current position */
+        mouse_ev_dropped = 0;
+        mouse_ev_x = mouse_x;
+        mouse_ev_y = mouse_y;
+        if ((mouse_ev_x != x_last) || (mouse_ev_y != y_last)) {
+            gadget_mouse_move(mouse_ev_x, mouse_ev_y);
+            x_last = mouse_ev_x;
+            y_last = mouse_ev_y;
+        }
     }
-    mouse_poll_buttons();
 }
 
 void
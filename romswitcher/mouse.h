@@ -25,8 +25,11 @@
 
 void mouse_init(void);
 void mouse_poll(void);
+void mouse_vblank(void);
 
 extern int mouse_x;
 extern int mouse_y;
+extern int mouse_ev_x;
+extern int mouse_ev_y;
 
 #endif /* _MOUSE_H */
@@ -19,6 +19,7 @@
 #include "screen.h"
 #include "serial.h"
 #include "amiga_chipset.h"
+#include "draw.h"
 
 #define SCREEN_COLUMNS 80  // SCREEN_WIDTH / 8
 #define SCREEN_ROWS    26  // SCREEN_HEIGHT / 8
@@ -30,7 +31,7 @@ uint cursor_y;        // Cursor top-down row position in editor area
 uint cursor_visible;  // Cursor is visible on screen
 uint dbg_cursor_x;    // Debug cursor column position on screen
 uint dbg_cursor_y;    // Debug cursor row position on screen
-uint dbg_all_scroll;  // Number of lines where all bitplanes should scroll
+uint screen_top;      // Bitplane ring line at top of display
 uint displaybeep;     // DisplayBeep is active when non-zero
 
 static const uint8_t
@@ -262,38 +263,6 @@ font_fixed_8x8[] =
     0xc6, 0x00, 0xc6, 0xc6, 0xc6, 0x7e, 0x06, 0x7c,  // ""
 };
 
-/*
- * blitter_is_busy
- * ---------------
- * Returns non-zero (true) if the blitter is busy
- */
-static uint
-blitter_is_busy(void)
-{
-    /* Test twice to cover blitter bugs (from NetBSD) */
-    return ((*DMACONR & DMACON_BBUSY) ||
-            (*DMACONR & DMACON_BBUSY));
-}
-
-/*
- * WaitBlit
- * --------
- * Wait until blitter is not busy
- *
- * A screen scroll was measured at about 8442 us
- *      (~9 serial characters at 9600 bps)
- */
-void
-WaitBlit(void)
-{
-    while (blitter_is_busy()) {
-        __asm("nop");
-        __asm("nop");
-        __asm("nop");
-    }
-}
-
-
 #if 0
 void
 blit(void)
@@ -315,38 +284,188 @@ blit(void)
 }
 #endif
 
+/*
+ * The copper list loads the bitplane pointers at the start of each frame,
+ * and again at the display line where the bitplane rings wrap. There are
+ * two copper lists. During vertical blank, the one not in use is rebuilt
+ * for the requested screen_top_next and the copper is restarted with it.
+ * screen_top is updated at the same time, so drawing code and the display
+ * always agree on the visible origin.
+ */
+#define DIW_VSTART      0x2c  // First display line (see DIWSTRT)
+#define COPPER_WORDS    (2 * 2 * SCREEN_BITPLANES * 2 + 3 * 2)
+__attribute__((aligned(4)))
+static uint16_t __chip copper_list[2][COPPER_WORDS];
+static uint copper_cur;
+static uint copper_top;  // screen_top of the active copper list
+static volatile uint screen_top_next;  // screen_top requested by scroll
+
+/*
+ * copper_bplpt
+ * ------------
+ * Add copper moves which load all bitplane pointers with the specified
+ * ring line.
+ */
+static uint16_t *
+copper_bplpt(uint16_t *cl, uint line)
+{
+    uint plane;
+    for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
+        uint32_t addr = BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
+                        line * (SCREEN_WIDTH / 8);
+        uint16_t reg  = 0x0e0 + plane * 4;  // BPLxPTH
+        *(cl++) = reg;
+        *(cl++) = addr >> 16;
+        *(cl++) = reg + 2;
+        *(cl++) = (uint16_t) addr;
+    }
+    return (cl);
+}
+
+/*
+ * screen_copper_update
+ * --------------------
+ * Called from vertical blank. If a scroll is pending, build a copper list
+ * for screen_top_next in the copper list which is not in use, make it
+ * active immediately, and update screen_top. Nothing is done if the beam
+ * has already reached the display window, as the new list would then only
+ * take effect part way through the frame.
+ */
 void
-blitter_scroll(uint bitplane)
+screen_copper_update(void)
+{
+    uint      top   = screen_top_next;
+    uint      split = SCREEN_RING_LINES - top;  // Display line of wrap
+    uint16_t *cl;
+
+    if (top == copper_top)
+        return;
+    if (((*VPOSR >> 8) & 0x1ff) >= DIW_VSTART)
+        return;  // Too late for this frame
+    copper_top = top;
+
+    cl = copper_list[copper_cur ^ 1];
+    cl = copper_bplpt(cl, top);
+    if (split < DISPLAY_LINES) {
+        uint vpos = DIW_VSTART + split;
+        if (vpos > 0xff) {
+            /* Wait for the beam to pass line 255 */
+            *(cl++) = 0xffdf;
+            *(cl++) = 0xfffe;
+        }
+        *(cl++) = ((vpos & 0xff) << 8) | 0x07;  // Wait for line start
+        *(cl++) = 0xfffe;
+        cl = copper_bplpt(cl, 0);
+    }
+    *(cl++) = 0xffff;  // End of copper list
+    *(cl++) = 0xfffe;
+
+    copper_cur ^= 1;
+    *COP1LC = (uintptr_t) copper_list[copper_cur];
+    *COPJMP1 = 0;  // Restart the copper now, before the display starts
+    screen_top = top;
+}
+
+/*
+ * screen_line_addr
+ * ----------------
+ * Return the address of the start of the specified screen line (in
+ * pixels) in the specified bitplane. Consecutive screen lines are only
+ * consecutive in memory up to the end of the bitplane ring;
+ * screen_lines_to_wrap() tells how many lines that is.
+ */
+uintptr_t
+screen_line_addr(uint plane, uint y)
 {
-    uint width  = SCREEN_WIDTH / 16;  // between 1 and 64 words
-    uint height = (SCREEN_ROWS + 1) * FONT_HEIGHT;  // max 1024
-    uint32_t base = BITPLANE_0_BASE + BITPLANE_OFFSET * bitplane;
+    uint line = screen_top + y;
+    if (line >= SCREEN_RING_LINES)
+        line -= SCREEN_RING_LINES;
+    return (BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
+            line * (SCREEN_WIDTH / 8));
+}
 
-    WaitBlit();
+/*
+ * screen_lines_to_wrap
+ * --------------------
+ * Return the number of screen lines, starting at the specified line,
+ * which are consecutive in bitplane memory.
+ */
+uint
+screen_lines_to_wrap(uint y)
+{
+    uint line = screen_top + y;
+    if (line >= SCREEN_RING_LINES)
+        line -= SCREEN_RING_LINES;
+    return (SCREEN_RING_LINES - line);
+}
 
-    *BLTCON0 = 0x09f0;
-    *BLTCON1 = 0;
-    *BLTAMOD = 0;
-    *BLTDMOD = 0;
-    *BLTDPTH = base;                    // destination
-    *BLTAPTH = base + SCREEN_WIDTH * 1; // source
+/*
+ * screen_scroll
+ * -------------
+ * Scroll the screen up by one text line. This is done by moving the
+ * start of the display within the bitplane rings, so only the newly
+ * exposed line needs to be cleared. The new origin takes effect at the
+ * next vertical blank, which this function waits for. Previously, the
+ * whole screen was moved with the Blitter (measured at about 8442 us per
+ * scroll).
+ */
+void
+screen_scroll(void)
+{
+    uint   plane;
+    uint   next;
+    blit_t b;
+
+    memset(&b, 0, sizeof (b));
+    b.bq_con0 = BLTCON0_AREA_USED;  // Channel D only, D = 0
+    b.bq_afwm = 0xffff;
+    b.bq_alwm = 0xffff;
+    b.bq_size = (FONT_HEIGHT << 6) | (SCREEN_WIDTH / 16);
+    for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
+        b.bq_dpt = screen_line_addr(plane, DISPLAY_LINES);
+        blit_queue_add(&b);
+    }
 
-    if (height < 150) {
-        *BLTSIZE = (height << 6) | width;
-    } else {
-        uint t_height = 150;
-        *BLTSIZE = (t_height << 6) | width;
-        height -= t_height;
-        WaitBlit();
-        *BLTCON0 = 0x09f0;
-        *BLTCON1 = 0;
-        *BLTAMOD = 0;
-        *BLTDMOD = 0;
-        *BLTDPTH = base + t_height * SCREEN_WIDTH / 8;
-        *BLTAPTH = base + t_height * SCREEN_WIDTH / 8 +
-                                     SCREEN_WIDTH * 1;  // next line
-        *BLTSIZE = (height << 6) | width;
-        WaitBlit();
+    if (screen_top + FONT_HEIGHT >= SCREEN_RING_LINES)
+        next = screen_top + FONT_HEIGHT - SCREEN_RING_LINES;
+    else
+        next = screen_top + FONT_HEIGHT;
+    screen_top_next = next;
+
+    /*
+     * Poll as well, in case the vertical blank interrupt can't run
+     * (such as when called with interrupts masked).
+     */
+    while (screen_top != next) {
+        uint32_t sr = irq_disable();
+        screen_copper_update();
+        irq_restore(sr);
+    }
+}
+
+/*
+ * glyph_cache holds the font pre-expanded to one glyph per 8-bit character
+ * code, so characters below ' ' need no special handling. It's kept in
+ * chip RAM so that it is also reachable by the Blitter, and so that
+ * rendering doesn't need to read the (slow) ROM font on every character.
+ */
+#define GLYPH_CACHE_CHARS 256
+__attribute__((aligned(4)))
+static uint8_t __chip glyph_cache[GLYPH_CACHE_CHARS * FONT_HEIGHT];
+
+/*
+ * glyph_cache_init
+ * ----------------
+ * Expand the ROM font into the glyph cache.
+ */
+static void
+glyph_cache_init(void)
+{
+    uint ch;
+    for (ch = 0; ch < GLYPH_CACHE_CHARS; ch++) {
+        uint glyph = (ch < ' ') ? 0 : (ch - ' ');
+        memcpy(&glyph_cache[ch * FONT_HEIGHT],
+               &font_fixed_8x8[glyph * FONT_HEIGHT], FONT_HEIGHT);
     }
 }
 
@@ -358,19 +477,30 @@ blitter_scroll(uint bitplane)
 static void
 render_char(uint8_t ch)
 {
-    const uint8_t *ptr = &font_fixed_8x8[(ch - ' ') * 8];
-    uint8_t *bpl = ADDR8(BITPLANE_0_BASE + dbg_cursor_x +
-                         dbg_cursor_y * SCREEN_WIDTH);
+    const uint8_t *ptr = &glyph_cache[ch * FONT_HEIGHT];
+    uint8_t *bpl = ADDR8(screen_line_addr(0, dbg_cursor_y * FONT_HEIGHT) +
+                         dbg_cursor_x);
     uint line;
+
+    WaitBlit();  // A queued clear may still be in progress on this line
     for (line = 0; line < FONT_HEIGHT; line++) {
         *bpl = *(ptr++);
-        bpl += (SCREEN_WIDTH / 8);
+        SCREEN_NEXT_LINE(bpl, 0);
     }
 }
 
+/*
+ * There are two render buffers, used alternately. The Blitter may still
+ * be reading from one while the CPU is filling the other. The queue mark
+ * taken after each buffer's blits were queued tells when the buffer may
+ * be reused.
+ */
 #define RENDER_BUF_CHARS 128
+#define RENDER_BUFS      2
 __attribute__((aligned(4)))
-uint8_t __chip render_buf[RENDER_BUF_CHARS * FONT_HEIGHT];
+uint8_t __chip render_buf[RENDER_BUFS][RENDER_BUF_CHARS * FONT_HEIGHT];
+static uint render_buf_cur;
+static uint render_buf_mark[RENDER_BUFS];
 
 
 /*
@@ -379,9 +509,9 @@ uint8_t __chip render_buf[RENDER_BUF_CHARS * FONT_HEIGHT];
  * Copy a single character to the specified buffer.
  */
 static void
-render_char_to_buf(char ch, char *buf)
+render_char_to_buf(uint8_t ch, uint8_t *buf)
 {
-    const uint8_t *ptr = &font_fixed_8x8[(ch - ' ') * FONT_HEIGHT];
+    const uint8_t *ptr = &glyph_cache[ch * FONT_HEIGHT];
     uint line;
     for (line = 0; line < FONT_HEIGHT; line++) {
         *buf = *ptr;
@@ -390,36 +520,25 @@ render_char_to_buf(char ch, char *buf)
     }
 }
 
-
-#include "printf.h"
 /*
- * render_text_at
- * --------------
- * Draw a string at the specified screen x and y coordinates.
- * Note that x and y are specified in pixels and not cursor position.
+ * render_text_at_cpu
+ * ------------------
+ * Copy already rendered text from the render buffer to the screen using
+ * the CPU. This is the fallback for when the Blitter can't be used.
  */
-void
-render_text_at(const char *str, uint maxlen, uint x, uint y,
-               uint fg_color, uint bg_color)
+static void
+render_text_at_cpu(const uint8_t *rbuf, uint len, uint x, uint y,
+                   uint fg_color, uint bg_color)
 {
-    char *rbuf = render_buf;
     uint plane;
-    uint len = 0;
     uint line;
 
-    if (maxlen > RENDER_BUF_CHARS)
-        maxlen = RENDER_BUF_CHARS;
-    for (rbuf = render_buf; *str != '\0'; str++) {
-        render_char_to_buf(*str, rbuf++);
-        if ((++len == maxlen))
-            break;
-    }
+    WaitBlit();  // Don't race with queued Blitter operations
 
     if ((x & 7) == 0) {
         /* Horizontal position is aligned to byte - YAY! */
         for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
-            uint8_t *bpl = ADDR8(BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
-                                 x / 8 + y * SCREEN_WIDTH / 8);
+            uint8_t *bpl = ADDR8(screen_line_addr(plane, y) + x / 8);
             /*
              * There are four possible fill modes:
              *   A) Empty: neither Fg nor Bg color selects this bitplane
@@ -432,30 +551,30 @@ render_text_at(const char *str, uint maxlen, uint x, uint y,
                     /* A) Empty: neither Fg nor Bg color selects bitplane */
                     for (line = 0; line < FONT_HEIGHT; line++) {
                         memset(bpl, 0, len);
-                        bpl += (SCREEN_WIDTH / 8);
+                        SCREEN_NEXT_LINE(bpl, plane);
                     }
                 } else {
                     /* B) Invert Text: only Bg color selects this bitplane */
                     for (line = 0; line < FONT_HEIGHT; line++) {
                         uint pos;
-                        uint8_t *rp = render_buf + line * RENDER_BUF_CHARS;
+                        const uint8_t *rp = rbuf + line * RENDER_BUF_CHARS;
                         for (pos = 0; pos < len; pos++)
                             bpl[pos] = *(rp++) ^ 0xff;
-                        bpl += (SCREEN_WIDTH / 8);
+                        SCREEN_NEXT_LINE(bpl, plane);
                     }
                 }
             } else {
                 if ((bg_color & BIT(plane)) == 0) {
                     /* C) Text: only Fg color selects this bitplane */
                     for (line = 0; line < FONT_HEIGHT; line++) {
-                        memcpy(bpl, render_buf + line * RENDER_BUF_CHARS, len);
-                        bpl += (SCREEN_WIDTH / 8);
+                        memcpy(bpl, rbuf + line * RENDER_BUF_CHARS, len);
+                        SCREEN_NEXT_LINE(bpl, plane);
                     }
                 } else {
                     /* D) Solid: both Fg and Bg color select this bitplane */
                     for (line = 0; line < FONT_HEIGHT; line++) {
                         memset(bpl, 0xff, len);
-                        bpl += (SCREEN_WIDTH / 8);
+                        SCREEN_NEXT_LINE(bpl, plane);
                     }
                 }
             }
@@ -479,8 +598,7 @@ render_text_at(const char *str, uint maxlen, uint x, uint y,
         }
 #endif
         for (plane = 0; plane < SCREEN_BITPLANES; plane++) {
-            uint8_t *rptr = ADDR8(BITPLANE_0_BASE + plane * BITPLANE_OFFSET +
-                                  x / 8 + y * SCREEN_WIDTH / 8);
+            uint8_t *rptr = ADDR8(screen_line_addr(plane, y) + x / 8);
             uint8_t  fill_and;
             uint8_t  fill_xor;
             /*
@@ -519,7 +637,7 @@ render_text_at(const char *str, uint maxlen, uint x, uint y,
 
             for (line = 0; line < FONT_HEIGHT; line++) {
                 uint8_t *ptr = rptr;
-                uint8_t *rend = ADDR8(render_buf + line * RENDER_BUF_CHARS);
+                const uint8_t *rend = rbuf + line * RENDER_BUF_CHARS;
                 uint8_t data = (*(rend++) & fill_and) ^ fill_xor;
 
                 /* Draw leading part of character */
@@ -539,12 +657,50 @@ render_text_at(const char *str, uint maxlen, uint x, uint y,
                 /* Draw trailing part of character */
                 *ptr = (*ptr & ~right_mask) |
                        ((data << right_off) & right_mask);
-                rptr += SCREEN_WIDTH / 8;
+                SCREEN_NEXT_LINE(rptr, plane);
             }
         }
     }
 }
 
+#include "printf.h"
+/*
+ * render_text_at
+ * --------------
+ * Draw a string at the specified screen x and y coordinates.
+ * Note that x and y are specified in pixels and not cursor position.
+ *
+ * The string is first expanded from the glyph cache into a render buffer,
+ * which is then transferred to all bitplanes by the Blitter. The CPU
+ * is only used if the Blitter can't handle the requested width.
+ */
+void
+render_text_at(const char *str, uint maxlen, uint x, uint y,
+               uint fg_color, uint bg_color)
+{
+    uint8_t *rbuf = render_buf[render_buf_cur];
+    uint8_t *rptr;
+    uint len = 0;
+
+    if (maxlen > RENDER_BUF_CHARS)
+        maxlen = RENDER_BUF_CHARS;
+    blit_queue_wait(render_buf_mark[render_buf_cur]);
+    for (rptr = rbuf; *str != '\0'; str++) {
+        render_char_to_buf(*str, rptr++);
+        if ((++len == maxlen))
+            break;
+    }
+    if (len == 0)
+        return;
+
+    if (blit_text(rbuf, RENDER_BUF_CHARS, len, x, y, fg_color, bg_color)) {
+        render_text_at_cpu(rbuf, len, x, y, fg_color, bg_color);
+        return;
+    }
+    render_buf_mark[render_buf_cur] = blit_queue_mark();
+    render_buf_cur = (render_buf_cur + 1) % RENDER_BUFS;
+}
+
 void
 dbg_show_char(uint ch)
 {
@@ -580,21 +736,7 @@ next_row:
                 dbg_cursor_y++;
                 if (dbg_cursor_y > SCREEN_ROWS - 1) {
                     dbg_cursor_y = SCREEN_ROWS - 1;
-                    blitter_scroll(0);  // scroll screen
-                    if (dbg_all_scroll) {
-                        /* Scroll all color bitplanes */
-                        dbg_all_scroll--;
-                        blitter_scroll(1);
-                        blitter_scroll(2);
-                    }
-                    /*
-                     * XXX: Faster would be to double-buffer the screen
-                     *      and just tell the VBlank ISR the new desired
-                     *      start of screen. Blit would only need to occur
-                     *      when we get to the bottom of the larger buffer,
-                     *      where it would duplicate the bottom screen back
-                     *      to the top.
-                     */
+                    screen_scroll();
                 }
             }
             break;
@@ -672,6 +814,13 @@ screen_init(void)
     *BPL3PT   = BITPLANE_2_BASE;  // Bitplane 2 base address
     memset((void *) BITPLANE_0_BASE, 0x00, 0x10000);
 
+    /* The copper reloads the bitplane pointers on every frame */
+    screen_top = 0;
+    screen_top_next = 0;
+    copper_top = 1;  // Force the copper list to be built
+    while (copper_top != 0)
+        screen_copper_update();  // Waits for the beam to leave the display
+
     /*
      * The correct values for DIWSTRT and DIWSTTO are calculated as follows:
      * Calculation of DDFSTRT and DDFSTOP in the low-res mode:
@@ -711,17 +860,18 @@ screen_init(void)
     *BLTCON1  = 0;
     *BLTSIZE  = 0;
 
+    glyph_cache_init();
     serial_puts("\bB");
 
     *DMACON   = DMACON_SET |     // Enable
 //              DMACON_BLTPRI |  // Blitter gets priority over CPU
                 DMACON_DMAEN |   // Enable DMA
                 DMACON_BPLEN |   // Bitplane DMA
+                DMACON_COPEN |   // Copper DMA
                 DMACON_BLTEN;    // Blitter DMA
 
     *INTENA   = INTENA_SETCLR |  // Set
                 INTENA_INTEN |   // Enable interrupts
-                INTENA_VERTB;    // Vertical blank
-
-    dbg_all_scroll = 25;  // If scrolling, start by scrolling all bitplanes
+                INTENA_VERTB |   // Vertical blank
+                INTENA_BLIT;     // Blitter finished (starts queued blits)
 }
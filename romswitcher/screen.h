@@ -27,6 +27,24 @@
 #define BITPLANE_1_BASE   (BITPLANE_0_BASE + BITPLANE_OFFSET)
 #define BITPLANE_2_BASE   (BITPLANE_1_BASE + BITPLANE_OFFSET)
 
+/*
+ * Each bitplane is a ring of SCREEN_RING_LINES lines, of which the top
+ * DISPLAY_LINES are shown starting at ring line screen_top. The lines
+ * which are not shown hold exactly one row of text, which is cleared
+ * and then exposed at the bottom of the display on each scroll.
+ */
+#define SCREEN_RING_LINES (BITPLANE_OFFSET / (SCREEN_WIDTH / 8))
+#define DISPLAY_LINES     256  // Lines between DIWSTRT and DIWSTOP
+
+/* Advance a bitplane pointer to the same position on the next screen line */
+#define SCREEN_NEXT_LINE(ptr, plane) \
+    do { \
+        (ptr) += (SCREEN_WIDTH / 8) / sizeof (*(ptr)); \
+        if ((uintptr_t) (ptr) >= \
+            BITPLANE_0_BASE + ((plane) + 1) * BITPLANE_OFFSET) \
+            (ptr) -= BITPLANE_OFFSET / sizeof (*(ptr)); \
+    } while (0)
+
 #define TEXTPEN      1  // Black
 #define HIGHLIGHTPEN 4  // Gold
 
@@ -35,6 +53,10 @@ void dbg_show_string(const uint8_t *str);
 void render_text_at(const char *str, uint maxlen, uint x, uint y,
                     uint fg_color, uint bg_color);
 void screen_init(void);
+void screen_scroll(void);
+void screen_copper_update(void);
+uintptr_t screen_line_addr(uint plane, uint y);
+uint screen_lines_to_wrap(uint y);
 void screen_beep_handle(void);
 void screen_displaybeep(void);
 void WaitBlit(void);
@@ -48,7 +70,7 @@ extern uint cursor_y;        // Cursor top-down row position in editor area
 extern uint cursor_visible;  // Cursor is visible on screen
 extern uint dbg_cursor_x;    // Debug cursor column position on screen
 extern uint dbg_cursor_y;    // Debug cursor row position on screen
-extern uint dbg_all_scroll;  // Count of lines where all bitplanes should scroll
+extern uint screen_top;      // Bitplane ring line at top of display
 extern uint displaybeep;     // DisplayBeep is active when non-zero
 
 #endif /* _SCREEN_H */
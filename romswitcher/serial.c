@@ -56,7 +56,6 @@ input_rb_put(uint ch)
                 } else {
                     /* MED activated */
                     cursor_visible |= 2;
-                    dbg_all_scroll = 25;
                     dbg_cursor_y = 25;
                 }
                 magic_pos = 0;
@@ -28,6 +28,7 @@
 #include "timer.h"
 #include "keyboard.h"
 #include "printf.h"
+#include "draw.h"
 
 /*
  * Memory map
@@ -50,6 +51,7 @@
 #define GLOBALS_BASE (RAM_BASE + 0x10000)
 
 uint vblank_ints;
+volatile uint vblank_count;  // Free-running count of vertical blanks
 
 void Default(void);
 void reset_hi(void);
@@ -70,11 +72,15 @@ Audio(void)
     (*ADDR32(COUNTER0))++;  // counter
 }
 
-__attribute__ ((interrupt)) void
-Blitter(void)
+/*
+ * Blitter finished: start the next queued blit, if any
+ */
+static void
+blitter_handler(void)
 {
     *INTREQ = INTREQ_BLIT;
     (*ADDR32(COUNTER1))++;  // counter
+    blit_queue_irq();
 }
 
 void
@@ -178,37 +184,18 @@ SpurIRQ(void)
     reset_cpu();
 }
 
-__attribute__ ((interrupt)) void
-VBlank(void)
+static void
+vblank_handler(void)
 {
-    static uint16_t mouse_quad_last;
-    uint16_t mouse_quad_cur;
-
-    SAVE_A4();
-    GET_GLOBALS_PTR();
-
     /*
-     * Reset bitplane DMA pointers. This could also be done by the copper.
-     *
-     *   AddrPlanexH = address of bit plane x, bits 16-18
-     *   AddrPlanexL = address of bit plane x, bits 0-15
-     *   MOVE #AddrPlanelH,BPLlPTH initialize pointer to bit plane 1
-     *   MOVE #AddrPlanelL,BPLlPTL
-     *   MOVE #AddrPlane2H,BPLlPTH initialize pointer to bit plane 2
-     *   MOVE #AddrPlane2L,BPLlPTL
-     *   MOVE #AddrPlane3H,BPLlPTH initialize pointer to bit plane 3
-     *   MOVE #AddrPlane3L,BPLlPTL
-     *   MOVE #AddrPlane4H,BPLlPTH initialize pointer to bit plane 4
-     *   MOVE #AddrPlane4L,BPLlPTL
-     *   WAIT ($FF,$FE)
-     *   ;end of the Copper list (wait for an impossible screen position)
+     * Bitplane DMA pointers are reset by the copper list, which must be
+     * rebuilt here if the screen has scrolled.
      */
-    *BPL1PT  = BITPLANE_0_BASE;  // Bitplane 0 base address
-    *BPL2PT  = BITPLANE_1_BASE;  // Bitplane 1 base address
-    *BPL3PT  = BITPLANE_2_BASE;  // Bitplane 2 base address
+    screen_copper_update();
 
     *INTREQ = INTREQ_VERTB;
     (*ADDR32(COUNTER3))++;  // counter
+    vblank_count++;
 
     uint32_t sr = irq_disable();
     uint16_t cur = eclk_ticks();
@@ -217,22 +204,7 @@ VBlank(void)
     eclk_last_update = cur;
     irq_restore(sr);
 
-    int8_t move_x;
-    int8_t move_y;
-    mouse_quad_cur = *VADDR16(JOY0DAT);  // mouse X and Y counters
-    move_x = (mouse_quad_cur & 0xff) - (mouse_quad_last & 0xff);
-    move_y = (mouse_quad_cur >> 8) - (mouse_quad_last >> 8);
-    mouse_x += move_x * 2;
-    mouse_y += move_y;
-    if (mouse_x < 0)
-        mouse_x = 0;
-    if (mouse_x > SCREEN_WIDTH - 1)
-        mouse_x = SCREEN_WIDTH - 1;
-    if (mouse_y < 0)
-        mouse_y = 0;
-    if (mouse_y > SCREEN_HEIGHT + 8)
-        mouse_y = SCREEN_HEIGHT + 8;
-    mouse_quad_last = mouse_quad_cur;
+    mouse_vblank();
 
     /*
      * The first 32-bit word of the sprite data:
@@ -294,7 +266,22 @@ VBlank(void)
         }
         printf("\n");
     }
+}
+
+/*
+ * Level 3 interrupts: Copper, Vertical blank, and Blitter finished
+ */
+__attribute__ ((interrupt)) void
+Level3(void)
+{
+    uint16_t intreq = *INTREQR;
 
+    SAVE_A4();
+    GET_GLOBALS_PTR();
+    if (intreq & INTREQ_BLIT)
+        blitter_handler();
+    if (intreq & INTREQ_VERTB)
+        vblank_handler();
     RESTORE_A4();
 }
 
@@ -323,7 +310,7 @@ const void *vectors[] =
             reset_hi, BusErr,  AddrErr, IllInst, DivZero, ChkInst, TrapV,
     PrivVio, Trace,   ExLineA, ExLineF, Default, Default, Default, Default,
     Default, Default, Default, Default, Default, Default, Default, Default,
-    SpurIRQ, Default, Ports,   VBlank,  Audio,   Default, Default, Default,
+    SpurIRQ, Default, Ports,   Level3,  Audio,   Default, Default, Default,
     Default, Default, Default, Default, Default, Default, Default, Default,
     Default, Default, Default, Default, Default, Default, Default, Default,
     Default, Default, Default, Default, Default, Default, Default, Default,
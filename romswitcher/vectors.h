@@ -19,5 +19,6 @@
 void vectors_init(void *base);
 
 extern uint vblank_ints;
+extern volatile uint vblank_count;
 
 #endif /* _VECTORS_H */
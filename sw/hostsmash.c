@@ -85,6 +85,7 @@ static const struct option long_opts[] = {
     { "all",      no_argument,       NULL, 'A' },
     { "addr",     required_argument, NULL, 'a' },
     { "bank",     required_argument, NULL, 'b' },
+    { "catalog",  no_argument,       NULL, 'C' },
     { "delay",    required_argument, NULL, 'D' },
     { "device",   required_argument, NULL, 'd' },
     { "debugfs",  no_argument,       NULL, 0x80 + 'f' },
@@ -96,6 +97,7 @@ static const struct option long_opts[] = {
     { "len",      required_argument, NULL, 'l' },
     { "mount",    required_argument, NULL, 'm' },
     { "Mount",    required_argument, NULL, 'M' },
+    { "profile",  required_argument, NULL, 'P' },
     { "read",     no_argument,       NULL, 'r' },
     { "swap",     required_argument, NULL, 's' },
     { "term",     no_argument,       NULL, 't' },
@@ -110,6 +112,7 @@ static char short_opts[] = {
     'A',         // --all
     'a', ':',    // --addr <addr>
     'b', ':',    // --bank <num>
+    'C',         // --catalog
     'c', ':',    // --clock [show|set]
     'D', ':',    // --delay <num>
     'd', ':',    // --device <filename>
@@ -120,6 +123,7 @@ static char short_opts[] = {
     'l', ':',    // --len <num>
     'm', ':',    // --mount <vol> <dir>
     'M', ':',    // --Mount <vol> <dir>
+    'P', ':',    // --profile <msec>
     'r',         // --read <filename>
     's', ':',    // --swap <mode>
     't',         // --term
@@ -135,6 +139,7 @@ static const char usage_text[] =
 "    -A --all                show all verify miscompares\n"
 "    -a --addr <addr>        starting EEPROM address\n"
 "    -b --bank <num>         starting EEPROM address as multiple of file size\n"
+"    -C --catalog            identify bank contents from the host catalog\n"
 "    -c --clock [show|set]   show or set Kicksmash time of day clock\n"
 "    -D --delay <msec>       pacing delay between sent characters (ms)\n"
 "    -d --device <filename>  serial device to use (e.g. /dev/ttyACM0)\n"
@@ -150,12 +155,14 @@ static const char usage_text[] =
 "    -i --identify           identify installed EEPROM\n"
 "    -l --len <num>          length in bytes\n"
 "    -m --mount <vol:> <dir> file serve directory path to Amiga volume\n"
+"    -P --profile <msec> [<map>] profile Amiga Kickstart ROM fetches\n"
 "    -r --read <filename>    read EEPROM and write to file\n"
 "    -s --swap <mode>        byte swap mode (2301, 3210, 1032, noswap=0123)\n"
 "    -v --verify <filename>  verify file matches EEPROM contents\n"
 "    -w --write <filename>   read file and write to EEPROM\n"
 "    -t --term [<command>]   operate in terminal mode (CLI) to KickSmash\n"
 "    -y --yes                answer all prompts with 'yes'\n"
+"    KICKSMASH_CATALOG=<fn>  catalog file (default ~/.kicksmash_catalog)\n"
 "    TERM_DEBUG=`tty`        env variable for communication debug output\n"
 "    TERM_DEBUG_HEX=1        show debug output in hex instead of ASCII\n"
 "\n"
@@ -226,8 +233,10 @@ timespec_to_timeval(struct timeval *tv, struct timespec *ts)
 #define MODE_VERIFY    0x0010
 #define MODE_WRITE     0x0020
 #define MODE_MSG       0x0040
+#define MODE_CATALOG   0x0080
 #define MODE_CLOCK_GET 0x0100
 #define MODE_CLOCK_SET 0x0200
+#define MODE_PROFILE   0x0400
 
 /* XXX: Need to register USB device ID at http://pid.codes */
 #define MX_VENDOR 0x1209
@@ -240,6 +249,8 @@ timespec_to_timeval(struct timeval *tv, struct timespec *ts)
 #define ADDR_NOT_SPECIFIED        0xffffffff
 
 #define DATA_CRC_INTERVAL         256  // How often CRC is sent (bytes)
+#define EEPROM_READ_CHUNK         1024 // Requested read CRC interval (bytes)
+#define EEPROM_READ_WINDOW        6    // Requested read status window
 
 /* Enable for gdb debug */
 #undef DEBUG_CTRL_C_KILL
@@ -289,9 +300,16 @@ timespec_to_timeval(struct timeval *tv, struct timespec *ts)
 #define SEEK_OFFSET_CURRENT   (0)
 #define SEEK_OFFSET_END       (1)
 
+#define IS_DOT(x)     (((x)[0] == '.') && ((x)[1] == '\0'))
+#define IS_DOT_DOT(x) (((x)[0] == '.') && ((x)[1] == '.') && ((x)[2] == '\0'))
+
 typedef unsigned int uint;
 
 static void discard_input(int timeout);
+static void send_msg_flush(void);
+static uint send_ks_cmd(uint cmd, void *txbuf, uint txlen, void *rxbuf,
+                        uint rxmax, uint *rxstatus, uint *rxlen, uint flags);
+static const char *smash_err(uint code);
 
 typedef enum {
     RC_SUCCESS = 0,
@@ -373,6 +391,7 @@ static bool             force_yes         = FALSE;
 static uint             swapmode          = SWAPMODE_AUTO;
 static uint             kicksmash_mode    = KICKSMASH_MODE_AUTO;
 static char            *terminal_cmd      = NULL;
+static uint             ks_features       = 0;  // Kicksmash si_features
 
 #ifdef __MINGW32__
 #define AT_FDCWD 0
@@ -1575,9 +1594,9 @@ check_rc(uint pos)
 }
 
 /*
- * receive_ll_crc() receives data from the remote side with status and
- *                  CRC data embedded. This function checks status and CRC
- *                  and sends status back to the remote side.
+ * receive_ll_crc_stream() receives data from the remote side with status and
+ *                         CRC data embedded. This function checks status and
+ *                         CRC and sends status back to the remote side.
  *
  * Protocol:
  *     SENDER:   <status> <data> <CRC> [<Status> <data> <CRC>...]
@@ -1586,22 +1605,34 @@ check_rc(uint pos)
  * SENDER
  *     The <status> byte is whether a failure occurred reading the data.
  *     If the sender is hostsmash, then it could also be user abort.
- *     <data> is 256 bytes (or less if the remaining transfer length is
- *     less than that amount. <CRC> is a 32-bit CRC over the previous
- *     (up to) 256 bytes of data.
+ *     <data> is one chunk, 256 bytes unless a different size was negotiated
+ *     (or less if the remaining transfer length is less than that amount).
+ *     <CRC> is a 32-bit rolling CRC over all data sent so far.
  * RECEIVER
  *     The <status> byte is whether the received data matched the CRC.
  *     If the receiver is the programmer, then the <status> byte also
  *     indicates whether the data write was successful.
  *
+ * If a sink function is provided, each chunk is received into the start of
+ * buf (which need only be one chunk in size) and is passed to the sink
+ * after its CRC has been verified. Otherwise, data accumulates in buf.
+ * With a sink, the returned count only includes chunks passed to the sink,
+ * and a failure message sent by the programmer in place of data is shown.
+ *
  * @param  [out] buf     - Data received from the programmer.
  * @param  [in]  buflen  - Number of bytes to receive from programmer.
+ * @param  [in]  chunk   - Number of bytes between CRC values.
+ * @param  [in]  sink    - Function to consume each verified chunk, or NULL.
+ * @param  [in]  arg     - Argument for sink function.
  *
- * @return       -1 a send timeout occurred.
+ * @return       -1 a send timeout occurred or the sink failed.
  * @return       The number of bytes received.
  */
+typedef int (*rx_sink_t)(void *arg, uint8_t *data, uint len);
+
 static int
-receive_ll_crc(void *buf, size_t buflen)
+receive_ll_crc_stream(void *buf, size_t buflen, uint chunk, rx_sink_t sink,
+                      void *arg)
 {
     int      timeout = 200; // 200 ms
     uint     pos = 0;
@@ -1615,8 +1646,8 @@ receive_ll_crc(void *buf, size_t buflen)
 
     while (pos < buflen) {
         tlen = buflen - pos;
-        if (tlen > DATA_CRC_INTERVAL)
-            tlen = DATA_CRC_INTERVAL;
+        if (tlen > chunk)
+            tlen = chunk;
 
         received = receive_ll(&rc, 1, timeout, true);
         if (received == 0) {
@@ -1633,13 +1664,33 @@ receive_ll_crc(void *buf, size_t buflen)
 #ifdef DEBUG_TRANSFER
         printf("c:%02x\n", crc); fflush(stdout);
 #endif
-        if (check_crc(crc, pos, pos + received, true))
-            return (pos + received);
+        if (check_crc(crc, pos, pos + received, true)) {
+            if (sink == NULL)
+                return (pos + received);
 
-        data   += received;
-        pos    += received;
+            /*
+             * The chunk was not passed to the sink. The programmer may
+             * have sent a failure message in place of data.
+             */
+            if (received >= 11) {
+                char tail[12];
+                memcpy(tail, data + received - 11, 11);
+                tail[11] = '\0';
+                if (strcasestr(tail, "FAILURE") != NULL)
+                    printf("Read %.11s\n", tail);
+            }
+            return (pos);
+        }
 
-        percent = (pos * 100) / buflen;
+        if (sink != NULL) {
+            if (sink(arg, data, received))
+                return (-1);
+        } else {
+            data += received;
+        }
+        pos += received;
+
+        percent = ((uint64_t) pos * 100) / buflen;
         if (lpercent != percent) {
             lpercent = percent;
             printf("\r%zu%%", percent);
@@ -1922,6 +1973,55 @@ ask_again:
     return (FALSE);
 }
 
+/*
+ * swap_buffer() swaps bytes in the specified buffer in a fixed order.
+ *
+ * @param  [io]  buf     - Buffer to modify.
+ * @param  [in]  len     - Length of data in the buffer.
+ * @param  [in]  swap    - Swap to perform (0, 1032, 2301, or 3210).
+ * @return       The swap which was performed.
+ */
+static uint
+swap_buffer(uint8_t *buf, uint len, uint swap)
+{
+    uint    pos;
+    uint8_t temp;
+
+    switch (swap) {
+        case 1032:
+            /* Swap adjacent bytes in 16-bit words */
+            for (pos = 0; pos + 1 < len; pos += 2) {
+                temp         = buf[pos + 0];
+                buf[pos + 0] = buf[pos + 1];
+                buf[pos + 1] = temp;
+            }
+            break;
+        case 2301:
+            /* Swap adjacent (16-bit) words */
+            for (pos = 0; pos + 3 < len; pos += 4) {
+                temp         = buf[pos + 0];
+                buf[pos + 0] = buf[pos + 2];
+                buf[pos + 2] = temp;
+                temp         = buf[pos + 1];
+                buf[pos + 1] = buf[pos + 3];
+                buf[pos + 3] = temp;
+            }
+            break;
+        case 3210:
+            /* Swap bytes in 32-bit longs */
+            for (pos = 0; pos + 3 < len; pos += 4) {
+                temp         = buf[pos + 0];
+                buf[pos + 0] = buf[pos + 3];
+                buf[pos + 3] = temp;
+                temp         = buf[pos + 1];
+                buf[pos + 1] = buf[pos + 2];
+                buf[pos + 2] = temp;
+            }
+            break;
+    }
+    return (swap);
+}
+
 /*
  * execute_swapmode() swaps bytes in the specified buffer according to the
  *                    currently active swap mode.
@@ -1929,14 +2029,13 @@ ask_again:
  * @param  [io]  buf     - Buffer to modify.
  * @param  [in]  len     - Length of data in the buffer.
  * @gloabl [in]  dir     - Image swap direction (SWAP_TO_ROM or SWAP_FROM_ROM)
- * @return       None.
+ * @return       The swap which was applied (0, 1032, 2301, or 3210). This may
+ *               be passed to swap_buffer() for following parts of the image.
  */
-static void
+static uint
 execute_swapmode(uint8_t *buf, uint len, uint dir)
 {
     bool_t  printed    = FALSE;
-    uint    pos;
-    uint8_t temp;
     static const uint8_t str_f94e1411[] = { 0xf9, 0x4e, 0x14, 0x11 };
     static const uint8_t str_11144ef9[] = { 0x11, 0x14, 0x4e, 0xf9 };
     static const uint8_t str_1411f94e[] = { 0x14, 0x11, 0xf9, 0x4e };
@@ -1967,57 +2066,29 @@ execute_swapmode(uint8_t *buf, uint len, uint dir)
     switch (swapmode) {
         case 0:
         case 0123:
-            return;  // Normal (no swap)
-        swap_1032:
+            return (0);  // Normal (no swap)
         case 1032:
-            /* Swap adjacent bytes in 16-bit words */
-            for (pos = 0; pos < len - 1; pos += 2) {
-                temp         = buf[pos + 0];
-                buf[pos + 0] = buf[pos + 1];
-                buf[pos + 1] = temp;
-            }
-            return;
-        swap_2301:
         case 2301:
-            /* Swap adjacent (16-bit) words */
-            for (pos = 0; pos < len - 3; pos += 4) {
-                temp         = buf[pos + 0];
-                buf[pos + 0] = buf[pos + 2];
-                buf[pos + 2] = temp;
-                temp         = buf[pos + 1];
-                buf[pos + 1] = buf[pos + 3];
-                buf[pos + 3] = temp;
-            }
-            return;
-        swap_3210:
         case 3210:
-            /* Swap bytes in 32-bit longs */
-            for (pos = 0; pos < len - 3; pos += 4) {
-                temp         = buf[pos + 0];
-                buf[pos + 0] = buf[pos + 3];
-                buf[pos + 3] = temp;
-                temp         = buf[pos + 1];
-                buf[pos + 1] = buf[pos + 2];
-                buf[pos + 2] = temp;
-            }
-            return;
+            swap_buffer(buf, len, swapmode);
+            return (swapmode);
         case SWAPMODE_A500:
             if (dir == SWAP_TO_ROM) {
                 /* Need bytes in order: 14 11 f9 4e */
                 if (memcmp(buf, str_1411f94e, 4) == 0)
-                    return;  // Already in desired order
+                    return (0);  // Already in desired order
                 if (memcmp(buf, str_11144ef9, 4) == 0) {
                     printf("Swapping 2301\n");
-                    goto swap_2301;  // Swap adjacent 16-bit words
+                    return (swap_buffer(buf, len, 2301));  // Swap adjacent 16-bit words
                 }
             }
             if (dir == SWAP_FROM_ROM) {
                 /* Need bytes in order: 11 14 4e f9 */
                 if (memcmp(buf, str_11144ef9, 4) == 0)
-                    return;  // Already in desired order
+                    return (0);  // Already in desired order
                 if (memcmp(buf, str_1411f94e, 4) == 0) {
                     printf("Swapping 1032\n");
-                    goto swap_1032;  // Swap odd/even bytes
+                    return (swap_buffer(buf, len, 1032));  // Swap odd/even bytes
                 }
             }
             goto unrecognized;
@@ -2027,19 +2098,19 @@ execute_swapmode(uint8_t *buf, uint len, uint dir)
                 if (memcmp(buf, str_1411f94e, 4) == 0) {
                     if (printed)
                         printf("No swap\n");
-                    return;  // Already in desired order
+                    return (0);  // Already in desired order
                 }
                 if (memcmp(buf, str_4ef91114, 4) == 0) {
                     printf("Swapping 3210\n");
-                    goto swap_3210;  // Swap bytes in 32-bit longs
+                    return (swap_buffer(buf, len, 3210));  // Swap bytes in 32-bit longs
                 }
                 if (memcmp(buf, str_f94e1411, 4) == 0) {
                     printf("Swapping 2301\n");
-                    goto swap_2301;  // Swap adjacent 16-bit words
+                    return (swap_buffer(buf, len, 2301));  // Swap adjacent 16-bit words
                 }
                 if (memcmp(buf, str_11144ef9, 4) == 0) {
                     printf("Swapping 1032\n");
-                    goto swap_1032;  // Swap odd/even bytes
+                    return (swap_buffer(buf, len, 1032));  // Swap odd/even bytes
                 }
             }
             if (dir == SWAP_FROM_ROM) {
@@ -2047,19 +2118,19 @@ execute_swapmode(uint8_t *buf, uint len, uint dir)
                 if (memcmp(buf, str_4ef91114, 4) == 0) {
                     if (printed)
                         printf("No swap\n");
-                    return;  // Already in desired order
+                    return (0);  // Already in desired order
                 }
                 if (memcmp(buf, str_1411f94e, 4) == 0) {
                     printf("Swapping 3210\n");
-                    goto swap_3210;  // Swap bytes in 32-bit longs
+                    return (swap_buffer(buf, len, 3210));  // Swap bytes in 32-bit longs
                 }
                 if (memcmp(buf, str_11144ef9, 4) == 0) {
                     printf("Swapping 2301\n");
-                    goto swap_2301;  // Swap adjacent 16-bit words
+                    return (swap_buffer(buf, len, 2301));  // Swap adjacent 16-bit words
                 }
                 if (memcmp(buf, str_f94e1411, 4) == 0) {
                     printf("Swapping 1032\n");
-                    goto swap_1032;  // Swap odd/even bytes
+                    return (swap_buffer(buf, len, 1032));  // Swap odd/even bytes
                 }
             }
             goto unrecognized;
@@ -2069,19 +2140,19 @@ execute_swapmode(uint8_t *buf, uint len, uint dir)
                 if (memcmp(buf, str_f94e1411, 4) == 0) {
                     if (printed)
                         printf("No swap\n");
-                    return;  // Already in desired order
+                    return (0);  // Already in desired order
                 }
                 if (memcmp(buf, str_11144ef9, 4) == 0) {
                     printf("Swapping 3210\n");
-                    goto swap_3210;  // Swap bytes in 32-bit longs
+                    return (swap_buffer(buf, len, 3210));  // Swap bytes in 32-bit longs
                 }
                 if (memcmp(buf, str_1411f94e, 4) == 0) {
                     printf("Swapping 2301\n");
-                    goto swap_2301;  // Swap adjacent 16-bit words
+                    return (swap_buffer(buf, len, 2301));  // Swap adjacent 16-bit words
                 }
                 if (memcmp(buf, str_4ef91114, 4) == 0) {
                     printf("Swapping 1032\n");
-                    goto swap_1032;  // Swap odd/even bytes
+                    return (swap_buffer(buf, len, 1032));  // Swap odd/even bytes
                 }
             }
             if (dir == SWAP_FROM_ROM) {
@@ -2089,19 +2160,19 @@ execute_swapmode(uint8_t *buf, uint len, uint dir)
                 if (memcmp(buf, str_11144ef9, 4) == 0) {
                     if (printed)
                         printf("No swap\n");
-                    return;  // Already in desired order
+                    return (0);  // Already in desired order
                 }
                 if (memcmp(buf, str_f94e1411, 4) == 0) {
                     printf("Swapping 3210\n");
-                    goto swap_3210;  // Swap bytes in 32-bit longs
+                    return (swap_buffer(buf, len, 3210));  // Swap bytes in 32-bit longs
                 }
                 if (memcmp(buf, str_4ef91114, 4) == 0) {
                     printf("Swapping 2301\n");
-                    goto swap_2301;  // Swap adjacent 16-bit words
+                    return (swap_buffer(buf, len, 2301));  // Swap adjacent 16-bit words
                 }
                 if (memcmp(buf, str_1411f94e, 4) == 0) {
                     printf("Swapping 1032\n");
-                    goto swap_1032;  // Swap odd/even bytes
+                    return (swap_buffer(buf, len, 1032));  // Swap odd/even bytes
                 }
             }
             goto unrecognized;
@@ -2111,6 +2182,51 @@ unrecognized:
                  "Unrecognized Amiga ROM format: %02x %02x %02x %02x\n",
                  buf[0], buf[1], buf[2], buf[3]);
     }
+    return (0);
+}
+
+/*
+ * eeprom_blank_check() asks the programmer to scan an EEPROM range for data
+ *                      which is not erased. The scan runs entirely on the
+ *                      programmer at full bus speed.
+ *
+ * @param  [in]  addr    - The EEPROM starting address to check.
+ * @param  [in]  len     - The length (in bytes) to check.
+ * @param  [out] first   - Offset from addr of the first non-blank data, or
+ *                         0xffffffff if the entire range is blank.
+ * @param  [out] sectors - Number of sectors which are not blank.
+ * @return       0 on success.
+ * @return       1 if the programmer does not support the check or failed.
+ */
+static int
+eeprom_blank_check(uint addr, uint len, uint *first, uint *sectors)
+{
+    flash_blank_t reply;
+    uint32_t      args[2];
+    uint          status;
+    uint          rxlen;
+    uint          rc;
+
+    if (send_cmd("prom service"))
+        return (1);  // send_cmd() reported "timeout" in this case
+
+    args[0] = SWAP32(addr);
+    args[1] = SWAP32(len);
+    rc = send_ks_cmd(KS_CMD_FLASH_BLANK, args, sizeof (args),
+                     &reply, sizeof (reply), &status, &rxlen, 0);
+    if (rc == 0)
+        rc = status;
+    if (rc != 0) {
+        if (rc != KS_STATUS_UNKCMD)
+            printf("KS blank check failed: %d (%s)\n", rc, smash_err(rc));
+        return (1);
+    }
+    if (rxlen < sizeof (reply))
+        return (1);
+
+    *first   = SWAP32(reply.fb_first);
+    *sectors = SWAP32(reply.fb_sectors);
+    return (0);
 }
 
 /*
@@ -2202,6 +2318,17 @@ eeprom_erase(uint bank, uint addr, uint len)
             }
         }
     }
+
+    if ((addr != ADDR_NOT_SPECIFIED) && (len != EEPROM_SIZE_NOT_SPECIFIED)) {
+        uint first;
+        uint sectors;
+        if ((eeprom_blank_check(addr, len, &first, &sectors) == 0) &&
+            (first != 0xffffffff)) {
+            printf("FAIL: %u sector%s not erased, first data at 0x%x\n",
+                   sectors, (sectors == 1) ? "" : "s", addr + first);
+            return (1);
+        }
+    }
     return (0);
 }
 
@@ -2217,6 +2344,8 @@ eeprom_not_erased(uint bank, uint addr, uint len)
     uint curpos;
     uint value;
     uint paddr;
+    uint first;
+    uint sectors;
 
     if (len > 0x8000)
         printf("Verifying EEPROM area has been erased\n");
@@ -2226,6 +2355,15 @@ eeprom_not_erased(uint bank, uint addr, uint len)
         addr += bank * EEPROM_BANK_SIZE_DEFAULT;
     }
 
+    /* Use the programmer's own scan when available */
+    if (eeprom_blank_check(addr, len, &first, &sectors) == 0) {
+        if (first == 0xffffffff)
+            return (0);  // Completely erased
+        printf("%u sector%s not erased, first data at 0x%x\n",
+               sectors, (sectors == 1) ? "" : "s", addr + first);
+        return (1);
+    }
+
     /* Manually check the first 32 bytes */
     if (complen > 0x20)
         complen = 0x20;
@@ -2327,9 +2465,75 @@ get_kicksmash_mode(void)
     }
 }
 
+/*
+ * prom_read_start() issues a binary EEPROM read command to the programmer.
+ *                   A larger chunk size and deeper status window than the
+ *                   original protocol are requested. If the programmer does
+ *                   not acknowledge the request, the original command is
+ *                   sent instead.
+ *
+ * @param  [in]  addr  - The EEPROM starting address.
+ * @param  [in]  len   - The length to read.
+ * @return       The chunk size (CRC interval) accepted by the programmer.
+ * @return       0 - A timeout occurred.
+ */
+static uint
+prom_read_start(uint addr, uint len)
+{
+    char     cmd[64];
+    uint16_t accepted[2];
+
+    snprintf(cmd, sizeof (cmd), "prom read %x %x %x %x",
+             addr, len, EEPROM_READ_CHUNK, EEPROM_READ_WINDOW);
+    if (send_cmd(cmd))
+        return (0);  // send_cmd() reported "timeout" in this case
+
+    if ((receive_ll(accepted, sizeof (accepted), 200, false) ==
+         sizeof (accepted)) &&
+        (accepted[0] >= 4) && (accepted[0] <= EEPROM_READ_CHUNK) &&
+        ((accepted[0] & 3) == 0) &&
+        (accepted[1] >= 1) && (accepted[1] <= EEPROM_READ_WINDOW)) {
+        return (accepted[0]);
+    }
+
+    /* Older programmer firmware rejected the request */
+    discard_input(250);
+    snprintf(cmd, sizeof (cmd), "prom read %x %x", addr, len);
+    if (send_cmd(cmd))
+        return (0);  // send_cmd() reported "timeout" in this case
+    return (DATA_CRC_INTERVAL);
+}
+
+typedef struct {
+    FILE *rs_fp;       // Output file
+    uint  rs_swap;     // Swap to apply, determined by first chunk
+    uint  rs_first;    // Next chunk is the first of the image
+} read_sink_t;
+
+static int
+eeprom_read_sink(void *arg, uint8_t *data, uint len)
+{
+    read_sink_t *rs = arg;
+
+    if (rs->rs_first) {
+        rs->rs_first = 0;
+        rs->rs_swap = execute_swapmode(data, len, SWAP_FROM_ROM);
+    } else {
+        swap_buffer(data, len, rs->rs_swap);
+    }
+    if (fwrite(data, len, 1, rs->rs_fp) != 1) {
+        warn("Failed to write output file");
+        return (1);
+    }
+    return (0);
+}
+
 /*
  * eeprom_read() reads all or part of the EEPROM image from the programmer,
- *               writing output to a file.
+ *               writing output to a file. Data is written to a temporary
+ *               file, which replaces the output file only once the read
+ *               has completed, so an existing file is left untouched if
+ *               the read fails.
  *
  * @param  [in]  filename        - The file to write using EEPROM contents.
  * @param  [in]  bank            - Starting address addition multiplier for
@@ -2344,9 +2548,11 @@ get_kicksmash_mode(void)
 static void
 eeprom_read(const char *filename, uint bank, uint addr, uint len)
 {
-    char cmd[64];
-    char *eebuf;
-    int rxcount;
+    uint8_t    *eebuf;
+    char       *tmpname;
+    int         rxcount;
+    uint        chunk;
+    read_sink_t rs;
 
     if (addr == ADDR_NOT_SPECIFIED)
         addr = 0x000000;  // Start of EEPROM
@@ -2361,38 +2567,56 @@ eeprom_read(const char *filename, uint bank, uint addr, uint len)
     if (bank != BANK_NOT_SPECIFIED)
         addr += bank * EEPROM_BANK_SIZE_DEFAULT;
 
-    eebuf = malloc(len + 4);
+    /* Only a single chunk is held in memory at a time */
+    eebuf = malloc(EEPROM_READ_CHUNK + 4);
     if (eebuf == NULL)
-        errx(EXIT_FAILURE, "Could not allocate %u byte buffer", len);
+        errx(EXIT_FAILURE, "Could not allocate %u byte buffer",
+             EEPROM_READ_CHUNK);
+
+    tmpname = malloc(strlen(filename) + 5);
+    if (tmpname == NULL)
+        errx(EXIT_FAILURE, "Could not allocate file name");
+    sprintf(tmpname, "%s.tmp", filename);
+    rs.rs_fp = fopen(tmpname, "wb");
+    if (rs.rs_fp == NULL)
+        err(EXIT_FAILURE, "Failed to open %s", tmpname);
+    rs.rs_swap  = 0;
+    rs.rs_first = 1;
+
+    chunk = prom_read_start(addr, len);
+    if (chunk == 0) {
+        rxcount = -1;  // "timeout" was reported in this case
+    } else {
+        rxcount = receive_ll_crc_stream(eebuf, len, chunk,
+                                        eeprom_read_sink, &rs);
+    }
+    if (fclose(rs.rs_fp)) {
+        warn("Failed to write %s", tmpname);
+        rxcount = -1;
+    }
 
-    snprintf(cmd, sizeof (cmd) - 1, "prom read %x %x", addr, len);
-    cmd[sizeof (cmd) - 1] = '\0';
-    if (send_cmd(cmd))
-        goto read_fail; // "timeout" was reported in this case
-    rxcount = receive_ll_crc(eebuf, len);
-    if (rxcount == -1)
-        goto read_fail;  // Send error was reported
-    if (rxcount < len) {
+    if (rxcount == -1) {
+        /* Send error or file write error was reported */
+    } else if (rxcount < len) {
         printf("Receive failed at byte 0x%x.\n", rxcount);
-        if (strncmp(eebuf + rxcount - 11, "FAILURE", 8) == 0) {
-            rxcount -= 11;
-            printf("Read %.11s\n", eebuf + rxcount);
+        rxcount = -1;
+    } else {
+#ifdef __MINGW32__
+        unlink(filename);  // Windows rename() won't replace an existing file
+#endif
+        if (rename(tmpname, filename) != 0) {
+            warn("Failed to rename %s to %s", tmpname, filename);
+            rxcount = -1;
+        } else {
+            printf("Read 0x%x bytes from device and wrote to file %s\n",
+                   rxcount, filename);
         }
     }
-    if (rxcount > 0) {
-        size_t written;
-        FILE *fp = fopen(filename, "wb");
-        if (fp == NULL)
-            err(EXIT_FAILURE, "Failed to open %s", filename);
-        execute_swapmode((uint8_t *)eebuf, rxcount, SWAP_FROM_ROM);
-        written = fwrite(eebuf, rxcount, 1, fp);
-        if (written != 1)
-            err(EXIT_FAILURE, "Failed to write %s", filename);
-        fclose(fp);
-        printf("Read 0x%x bytes from device and wrote to file %s\n",
-               rxcount, filename);
+    if (rxcount == -1) {
+        unlink(tmpname);
+        printf("%s was not changed\n", filename);
     }
-read_fail:
+    free(tmpname);
     free(eebuf);
 }
 
@@ -2420,28 +2644,59 @@ file_read(const char *filename, uint len)
  * eeprom_write() uses the programmer to writes all or part of an EEPROM image.
  *                Content to write is sourced from a local file.
  *
+ *                If more than one copy is requested, the image is streamed
+ *                once and the programmer writes each received chunk to all
+ *                copies, which are placed back-to-back. Older programmer
+ *                firmware which rejects this is sent each copy separately.
+ *
  * @param  [in]  filebuf         - The file content to write.
  * @param  [in]  addr            - The EEPROM starting address.
  * @param  [io]  len             - The length to write.
+ * @param  [in]  copies          - The number of copies to write.
  * @return       0 - Verify successful.
  * @return       1 - Verify failed.
  * @exit         EXIT_FAILURE - The program will terminate on file access error.
  */
 static uint
-eeprom_write(const uint8_t *filebuf, uint addr, uint len)
+eeprom_write(const uint8_t *filebuf, uint addr, uint len, uint copies)
 {
     char        cmd[64];
     int         tcount = 0;
-
-    printf("Writing 0x%06x bytes to EEPROM starting at address 0x%x\n",
-           len, addr);
+    uint        copy;
 #ifdef __MINGW32__
     DWORD dwTickStart = GetTickCount();
 #endif
+
+    if (copies > 1) {
+        uint32_t accepted[2];
+
+        printf("Writing %u copies of 0x%06x bytes to EEPROM starting at "
+               "address 0x%x\n", copies, len, addr);
+        snprintf(cmd, sizeof (cmd) - 1, "prom write %x %x %x %x",
+                 addr, len, copies, len);
+        if (send_cmd(cmd))
+            return (-1); // "timeout" was reported in this case
+        if ((receive_ll(accepted, sizeof (accepted), 200, false) ==
+             sizeof (accepted)) &&
+            (accepted[0] == copies) && (accepted[1] == len)) {
+            goto send_data;
+        }
+
+        /* Older programmer firmware rejected the request */
+        discard_input(250);
+        for (copy = 0; copy < copies; copy++)
+            if (eeprom_write(filebuf, addr + copy * len, len, 1) != 0)
+                return (1);
+        return (0);
+    }
+
+    printf("Writing 0x%06x bytes to EEPROM starting at address 0x%x\n",
+           len, addr);
     snprintf(cmd, sizeof (cmd) - 1, "prom write %x %x", addr, len);
     if (send_cmd(cmd))
         return (-1); // "timeout" was reported in this case
 
+send_data:
     if (send_ll_crc(filebuf, len)) {
         errx(EXIT_FAILURE, "Send failure");
     }
@@ -2505,9 +2760,98 @@ show_fail_range(const uint8_t *filebuf, const uint8_t *eebuf, uint len,
 }
 
 
+/* State of a verify compare which runs while EEPROM data is arriving */
+typedef struct {
+    const uint8_t *vs_filebuf;         // Expected data
+    uint8_t       *vs_eebuf;           // Data received from EEPROM
+    uint           vs_addr;            // EEPROM base address
+    uint           vs_len;             // Total length to compare
+    uint           vs_avail;           // Bytes received so far
+    uint           vs_pos;             // Next position to compare
+    int            vs_first_fail_pos;  // Start of current miscompare range
+    uint           vs_miscompares;     // Miscompare count
+    uint           vs_miscompares_max; // Miscompares to verbosely report
+} verify_state_t;
+
+#define VERIFY_BLOCK 64  // Fast compare block size
+
+/*
+ * verify_compare() compares all data received so far which has not yet
+ *                  been compared. Matching blocks are skipped using a fast
+ *                  block compare; only blocks with a difference are
+ *                  examined byte-by-byte for miscompare reporting. A byte
+ *                  is not examined until the byte following it is
+ *                  available, so that single byte matches within a failure
+ *                  range are reported as part of that range.
+ */
+static void
+verify_compare(verify_state_t *vs)
+{
+    const uint8_t *filebuf = vs->vs_filebuf;
+    const uint8_t *eebuf   = vs->vs_eebuf;
+    uint           len     = vs->vs_len;
+    uint           end     = vs->vs_avail;
+    uint           pos     = vs->vs_pos;
+
+    if (end < len)
+        end--;  // Need one byte of lookahead
+
+    while (pos < end) {
+        if ((vs->vs_first_fail_pos == -1) && (pos + VERIFY_BLOCK <= end) &&
+            (memcmp(eebuf + pos, filebuf + pos, VERIFY_BLOCK) == 0)) {
+            pos += VERIFY_BLOCK;
+            continue;
+        }
+        if (eebuf[pos] != filebuf[pos]) {
+            vs->vs_miscompares++;
+            if (vs->vs_first_fail_pos == -1)
+                vs->vs_first_fail_pos = pos;
+            if (vs->vs_miscompares == vs->vs_miscompares_max) {
+                /* Report now and only count futher miscompares */
+                show_fail_range(filebuf, eebuf,
+                                pos - vs->vs_first_fail_pos + 1, vs->vs_addr,
+                                vs->vs_first_fail_pos, vs->vs_miscompares_max);
+                vs->vs_first_fail_pos = -1;
+            }
+        } else {
+            if ((pos < len - 1) &&
+                (eebuf[pos + 1] != filebuf[pos + 1])) {
+                /* Consider single byte matches part of failure range */
+                pos++;
+                continue;
+            }
+            if (vs->vs_first_fail_pos != -1) {
+                if (vs->vs_miscompares < vs->vs_miscompares_max) {
+                    /* Report previous range */
+                    show_fail_range(filebuf, eebuf,
+                                    pos - vs->vs_first_fail_pos, vs->vs_addr,
+                                    vs->vs_first_fail_pos,
+                                    vs->vs_miscompares_max);
+                }
+                vs->vs_first_fail_pos = -1;
+            }
+        }
+        pos++;
+    }
+    vs->vs_pos = pos;
+}
+
+static int
+eeprom_verify_sink(void *arg, uint8_t *data, uint len)
+{
+    verify_state_t *vs = arg;
+
+    memcpy(vs->vs_eebuf + vs->vs_avail, data, len);
+    vs->vs_avail += len;
+    verify_compare(vs);
+    return (0);
+}
+
 /*
  * eeprom_verify() reads an image from the eeprom and compares it against
  *                 a file on disk. Differences are reported for the user.
+ *                 Each chunk is compared as soon as it has been received,
+ *                 while following chunks are still in transit.
  *
  * @param  [in]  filename        - The file to compare EEPROM contents against.
  * @param  [in]  addr            - The EEPROM starting address.
@@ -2521,73 +2865,46 @@ show_fail_range(const uint8_t *filebuf, const uint8_t *eebuf, uint len,
 static int
 eeprom_verify(const uint8_t *filebuf, uint addr, uint len, uint miscompares_max)
 {
-    uint8_t    *eebuf;
-    char        cmd[64];
-    int         rxcount;
-    int         pos;
-    int         first_fail_pos = -1;
-    uint        miscompares = 0;
-
-    eebuf = malloc(len + 4);
+    uint8_t        rxbuf[EEPROM_READ_CHUNK + 4];
+    verify_state_t vs;
+    uint           chunk;
+    int            rxcount;
+
+    memset(&vs, 0, sizeof (vs));
+    vs.vs_filebuf         = filebuf;
+    vs.vs_eebuf           = malloc(len + 4);
+    vs.vs_addr            = addr;
+    vs.vs_len             = len;
+    vs.vs_first_fail_pos  = -1;
+    vs.vs_miscompares_max = miscompares_max;
+    if (vs.vs_eebuf == NULL)
+        errx(EXIT_FAILURE, "Could not allocate %u bytes", len);
 
-    snprintf(cmd, sizeof (cmd) - 1, "prom read %x %x", addr, len);
-    cmd[sizeof (cmd) - 1] = '\0';
-    if (send_cmd(cmd)) {
+    chunk = prom_read_start(addr, len);
+    if (chunk == 0) {
         /* "timeout" was reported in this case */
 fail_verify_read:
-        free(eebuf);
+        free(vs.vs_eebuf);
         return (1);
     }
-    rxcount = receive_ll_crc(eebuf, len);
+    rxcount = receive_ll_crc_stream(rxbuf, len, chunk,
+                                    eeprom_verify_sink, &vs);
     if (rxcount <= 0)
         goto fail_verify_read; // "timeout" was reported in this case
     if (rxcount < len) {
-        const char *str = (const char *) eebuf + rxcount - 11;
-        if ((strncmp(str, "FAILURE", 8) == 0) ||
-            (strcasestr(str, "FAILURE") != NULL)) {
-            rxcount -= 11;
-            printf("Read %.11s\n", eebuf + rxcount);
-        }
         printf("Only read 0x%x bytes of expected 0x%x\n", rxcount, len);
         goto fail_verify_read;
     }
 
-    /* Compare two buffers */
-    for (pos = 0; pos < len; pos++) {
-        if (eebuf[pos] != filebuf[pos]) {
-            miscompares++;
-            if (first_fail_pos == -1)
-                first_fail_pos = pos;
-            if (miscompares == miscompares_max) {
-                /* Report now and only count futher miscompares */
-                show_fail_range(filebuf, eebuf, pos - first_fail_pos + 1,
-                                addr, first_fail_pos, miscompares_max);
-                first_fail_pos = -1;
-            }
-        } else {
-            if ((pos < len - 1) &&
-                (eebuf[pos + 1] != filebuf[pos + 1])) {
-                /* Consider single byte matches part of failure range */
-                continue;
-            }
-            if (first_fail_pos != -1) {
-                if (miscompares < miscompares_max) {
-                    /* Report previous range */
-                    show_fail_range(filebuf, eebuf, pos - first_fail_pos,
-                                    addr, first_fail_pos, miscompares_max);
-                }
-                first_fail_pos = -1;
-            }
-        }
-    }
-    if ((first_fail_pos != -1) && (miscompares < miscompares_max)) {
+    if ((vs.vs_first_fail_pos != -1) &&
+        (vs.vs_miscompares < miscompares_max)) {
         /* Report final range not previously reported */
-        show_fail_range(filebuf, eebuf, pos - first_fail_pos, addr,
-                        first_fail_pos, miscompares_max);
+        show_fail_range(filebuf, vs.vs_eebuf, len - vs.vs_first_fail_pos,
+                        addr, vs.vs_first_fail_pos, miscompares_max);
     }
-    free(eebuf);
-    if (miscompares) {
-        printf("%u miscompares\n", miscompares);
+    free(vs.vs_eebuf);
+    if (vs.vs_miscompares) {
+        printf("%u miscompares\n", vs.vs_miscompares);
         return (1);
     } else {
         printf("Verify success\n");
@@ -2596,33 +2913,683 @@ fail_verify_read:
 }
 
 /*
- * amiga_is_in_reset
- * -----------------
- * Returns 1 if the Amiga is in reset.
- * Returns 0 if the Amiga is not in reset.
- * Returns -1 if there was an error communicating with Kicksmash.
+ * flash_crc_query() asks the programmer to compute the CRC32 of a range
+ *                   of flash. Large ranges are computed one bank at a time
+ *                   so that each request completes well within the reply
+ *                   timeout.
+ *
+ * @param  [in]  addr - The EEPROM starting address.
+ * @param  [in]  len  - The length (in bytes) of the range.
+ * @param  [out] crc  - The CRC32 of the range, as computed by crc32().
+ * @return       0 on success.
+ * @return       1 if the programmer does not support the query or failed.
  */
 static int
-amiga_is_in_reset(void)
+flash_crc_query(uint addr, uint len, uint32_t *crc)
 {
-    char cmd_output[100];
-    int  rxcount;
-    if (send_cmd("prom id"))
-        return (-1); // "timeout" was reported in this case
-    if (recv_output(cmd_output, sizeof (cmd_output), &rxcount, 80))
-        return (-1); // "timeout" was reported in this case
-    if (rxcount == 0) {
-        printf("Receive timeout\n");
-        return (-1);
+    static bool unsupported = FALSE;
+    uint32_t    args[3];
+    uint32_t    reply;
+    uint32_t    cur_crc = 0;
+    uint        status;
+    uint        rxlen;
+    uint        rc;
+
+    if (unsupported)
+        return (1);  // Don't wait for a reply timeout again
+    if (send_cmd("prom service"))
+        return (1);  // send_cmd() reported "timeout" in this case
+
+    while (len > 0) {
+        uint tlen = EEPROM_BANK_SIZE_DEFAULT;
+        if (tlen > len)
+            tlen = len;
+        args[0] = SWAP32(addr);
+        args[1] = SWAP32(tlen);
+        args[2] = SWAP32(cur_crc);
+        rc = send_ks_cmd(KS_CMD_FLASH_CRC, args, sizeof (args),
+                         &reply, sizeof (reply), &status, &rxlen, 0);
+        if (rc == 0)
+            rc = status;
+        if (rc != 0) {
+            if (rc != KS_STATUS_UNKCMD)
+                printf("KS CRC query failed: %d (%s)\n", rc, smash_err(rc));
+            if (rc != KS_STATUS_LOCKED)
+                unsupported = TRUE;
+            return (1);
+        }
+        if (rxlen < sizeof (reply))
+            return (1);
+        cur_crc = SWAP32(reply);
+        addr   += tlen;
+        len    -= tlen;
     }
-    if (strstr(cmd_output, "not in reset") != NULL)
-        return (0);
-    return (1);
+    *crc = cur_crc;
+    return (0);
 }
 
-static int
-reset_amiga(int hold)
-{
+/*
+ * Bank catalog
+ * ------------
+ * The catalog is a text file on the host which records the CRC32 of each
+ * image written to or verified against a Kicksmash, keyed by the device
+ * serial number and flash range. Comparing a catalog entry against the
+ * CRC computed on the device identifies bank contents without reading
+ * them, and detects changes made by other means (such as the Amiga-side
+ * smash utility). Each line contains:
+ *     <serial> <addr> <len> <crc> <time> <name>
+ */
+typedef struct catalog_ent catalog_ent_t;
+struct catalog_ent {
+    catalog_ent_t *ce_next;
+    char           ce_serial[24];
+    uint           ce_addr;
+    uint           ce_len;
+    uint32_t       ce_crc;
+    time_t         ce_time;
+    char           ce_name[256];
+};
+
+static catalog_ent_t *catalog_head = NULL;
+static char           catalog_serial[24];
+
+/*
+ * catalog_path() returns the path of the catalog file. The path may be
+ *                specified by the KICKSMASH_CATALOG environment variable,
+ *                and otherwise is .kicksmash_catalog in the home directory.
+ */
+static const char *
+catalog_path(void)
+{
+    static char path[PATH_MAX];
+    const char *env;
+
+    if ((env = getenv("KICKSMASH_CATALOG")) != NULL)
+        return (env);
+    if (((env = getenv("HOME")) == NULL) &&
+        ((env = getenv("USERPROFILE")) == NULL)) {
+        env = ".";
+    }
+    snprintf(path, sizeof (path), "%s/.kicksmash_catalog", env);
+    return (path);
+}
+
+/*
+ * catalog_load() reads the catalog file into memory. A missing catalog
+ *                is not an error.
+ */
+static void
+catalog_load(void)
+{
+    char  line[512];
+    FILE *fp = fopen(catalog_path(), "r");
+
+    if (fp == NULL)
+        return;
+
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        catalog_ent_t *ent;
+        catalog_ent_t **tail;
+        intmax_t       when;
+        int            pos = 0;
+        char          *eol;
+
+        if ((line[0] == '#') || (line[0] == '\n'))
+            continue;
+        ent = calloc(1, sizeof (*ent));
+        if (ent == NULL)
+            errx(EXIT_FAILURE, "Could not allocate catalog entry");
+        if (sscanf(line, "%23s %x %x %x %jd %n", ent->ce_serial,
+                   &ent->ce_addr, &ent->ce_len, &ent->ce_crc,
+                   &when, &pos) != 5) {
+            free(ent);
+            continue;
+        }
+        ent->ce_time = (time_t) when;
+        if ((eol = strchr(line + pos, '\n')) != NULL)
+            *eol = '\0';
+        strncpy(ent->ce_name, line + pos, sizeof (ent->ce_name) - 1);
+
+        /* Keep file order */
+        for (tail = &catalog_head; *tail != NULL; tail = &(*tail)->ce_next)
+            ;
+        *tail = ent;
+    }
+    fclose(fp);
+}
+
+/*
+ * catalog_save() writes the in-memory catalog back to the catalog file.
+ */
+static void
+catalog_save(void)
+{
+    catalog_ent_t *ent;
+    const char    *path = catalog_path();
+    FILE          *fp   = fopen(path, "w");
+
+    if (fp == NULL) {
+        warn("Could not write catalog %s", path);
+        return;
+    }
+    fprintf(fp, "# Kicksmash bank catalog: serial addr len crc time name\n");
+    for (ent = catalog_head; ent != NULL; ent = ent->ce_next) {
+        fprintf(fp, "%s %06x %06x %08x %jd %s\n", ent->ce_serial,
+                ent->ce_addr, ent->ce_len, ent->ce_crc,
+                (intmax_t) ent->ce_time, ent->ce_name);
+    }
+    fclose(fp);
+}
+
+/*
+ * catalog_get_serial() acquires the serial number of the attached
+ *                      Kicksmash, which keys catalog entries.
+ *
+ * @return       0 on success.
+ * @return       1 if the serial number could not be acquired.
+ */
+static int
+catalog_get_serial(void)
+{
+    smash_id_t id;
+    uint       status;
+    uint       rc;
+    char      *ptr;
+
+    if (catalog_serial[0] != '\0')
+        return (0);
+    if (send_cmd("prom service"))
+        return (1);  // send_cmd() reported "timeout" in this case
+    rc = send_ks_cmd(KS_CMD_ID, NULL, 0, &id, sizeof (id), &status, NULL, 0);
+    if ((rc != 0) || (status != 0) || (id.si_serial[0] == '\0'))
+        return (1);
+
+    id.si_serial[sizeof (id.si_serial) - 1] = '\0';
+    strcpy(catalog_serial, id.si_serial);
+    for (ptr = catalog_serial; *ptr != '\0'; ptr++)
+        if (isspace((uint8_t) *ptr))
+            *ptr = '_';
+    return (0);
+}
+
+/*
+ * catalog_record() records that an image now occupies the specified range
+ *                  of flash. Any catalog entries for this Kicksmash which
+ *                  overlap the range are replaced.
+ *
+ * @param  [in]  addr - The EEPROM starting address of the image.
+ * @param  [in]  len  - The length (in bytes) of the image.
+ * @param  [in]  crc  - The CRC32 of the image, as stored in flash.
+ * @param  [in]  name - The name of the image (typically the file name).
+ * @return       None.
+ */
+static void
+catalog_record(uint addr, uint len, uint32_t crc, const char *name)
+{
+    catalog_ent_t **prev;
+    catalog_ent_t  *ent;
+    const char     *base;
+
+    if (catalog_get_serial())
+        return;
+
+    prev = &catalog_head;
+    while ((ent = *prev) != NULL) {
+        if ((strcmp(ent->ce_serial, catalog_serial) == 0) &&
+            (ent->ce_addr < addr + len) &&
+            (ent->ce_addr + ent->ce_len > addr)) {
+            *prev = ent->ce_next;
+            free(ent);
+            continue;
+        }
+        prev = &ent->ce_next;
+    }
+
+    ent = calloc(1, sizeof (*ent));
+    if (ent == NULL)
+        errx(EXIT_FAILURE, "Could not allocate catalog entry");
+    if (((base = strrchr(name, '/')) != NULL) ||
+        ((base = strrchr(name, '\\')) != NULL)) {
+        name = base + 1;
+    }
+    strcpy(ent->ce_serial, catalog_serial);
+    strncpy(ent->ce_name, name, sizeof (ent->ce_name) - 1);
+    ent->ce_addr = addr;
+    ent->ce_len  = len;
+    ent->ce_crc  = crc;
+    ent->ce_time = time(NULL);
+    *prev = ent;
+
+    catalog_save();
+}
+
+/*
+ * catalog_find_crc() locates a catalog entry of the specified length and
+ *                    CRC, regardless of which Kicksmash or address it was
+ *                    recorded for.
+ */
+static const catalog_ent_t *
+catalog_find_crc(uint len, uint32_t crc)
+{
+    const catalog_ent_t *ent;
+
+    for (ent = catalog_head; ent != NULL; ent = ent->ce_next)
+        if ((ent->ce_len == len) && (ent->ce_crc == crc))
+            return (ent);
+    return (NULL);
+}
+
+/*
+ * catalog_show() reports the contents of each flash bank of the attached
+ *                Kicksmash according to the catalog. The device computes
+ *                a CRC of each recorded range, so entries which no longer
+ *                match (the bank was changed out-of-band) are detected.
+ *                Banks not covered by an entry are identified by CRC
+ *                against all catalog entries.
+ *
+ * @return       0 - Success.
+ * @return       1 - Failure.
+ */
+static int
+catalog_show(void)
+{
+    catalog_ent_t *ent;
+    uint8_t        covered[EEPROM_SIZE_DEFAULT / EEPROM_BANK_SIZE_DEFAULT];
+    uint8_t       *erased;
+    uint32_t       erased_crc;
+    uint32_t       crc;
+    uint           bank;
+    char           timebuf[32];
+
+    if (catalog_get_serial()) {
+        printf("Failed to get Kicksmash serial number\n");
+        return (1);
+    }
+    erased = malloc(EEPROM_BANK_SIZE_DEFAULT);
+    if (erased == NULL)
+        errx(EXIT_FAILURE, "Could not allocate %u bytes",
+             EEPROM_BANK_SIZE_DEFAULT);
+    memset(erased, 0xff, EEPROM_BANK_SIZE_DEFAULT);
+    erased_crc = crc32(0, erased, EEPROM_BANK_SIZE_DEFAULT);
+    free(erased);
+
+    printf("Catalog %s for Kicksmash \"%s\"\n", catalog_path(),
+           catalog_serial);
+    memset(covered, 0, sizeof (covered));
+    for (ent = catalog_head; ent != NULL; ent = ent->ce_next) {
+        if (strcmp(ent->ce_serial, catalog_serial) != 0)
+            continue;
+        if (flash_crc_query(ent->ce_addr, ent->ce_len, &crc)) {
+            printf("Kicksmash CRC query failed\n");
+            return (1);
+        }
+        strftime(timebuf, sizeof (timebuf), "%Y-%m-%d %H:%M",
+                 localtime(&ent->ce_time));
+        printf("  %06x-%06x %08x %s  %s%s\n", ent->ce_addr,
+               ent->ce_addr + ent->ce_len - 1, crc, timebuf, ent->ce_name,
+               (crc == ent->ce_crc) ? "" : " (CHANGED since recorded)");
+        for (bank = ent->ce_addr / EEPROM_BANK_SIZE_DEFAULT;
+             (bank < ARRAY_SIZE(covered)) &&
+             (bank * EEPROM_BANK_SIZE_DEFAULT < ent->ce_addr + ent->ce_len);
+             bank++) {
+            covered[bank] = 1;
+        }
+    }
+    for (bank = 0; bank < ARRAY_SIZE(covered); bank++) {
+        const catalog_ent_t *match;
+        uint addr = bank * EEPROM_BANK_SIZE_DEFAULT;
+        if (covered[bank])
+            continue;
+        if (flash_crc_query(addr, EEPROM_BANK_SIZE_DEFAULT, &crc)) {
+            printf("Kicksmash CRC query failed\n");
+            return (1);
+        }
+        match = catalog_find_crc(EEPROM_BANK_SIZE_DEFAULT, crc);
+        printf("  %06x-%06x %08x %16s  %s\n", addr,
+               addr + EEPROM_BANK_SIZE_DEFAULT - 1, crc, "",
+               (crc == erased_crc) ? "(erased)" :
+               (match != NULL) ? match->ce_name : "(unknown)");
+    }
+    return (0);
+}
+
+/*
+ * ROM fetch profiler
+ * ------------------
+ * Kicksmash streams the ROM word address of every Amiga fetch from
+ * Kickstart ROM (see "snoop stream" and snoop_frame_t). The profiler
+ * counts fetches per address and, given a symbol map file, per function.
+ * Each map file line contains an Amiga address in hex and a name:
+ *     <addr> <name>
+ * Other lines are ignored.
+ */
+#define PROFILE_ADDR_COUNT  (1 << 20)  // ROM word addresses A0-A19
+#define PROFILE_ROM_BASE    0xf80000   // Kickstart ROM Amiga address
+#define PROFILE_ROM_MASK    0x07ffff   // Kickstart ROM size - 1
+
+typedef struct {
+    uint32_t ps_addr;   // Amiga address of symbol
+    uint64_t ps_count;  // Fetches attributed to symbol
+    char    *ps_name;   // Symbol name
+} profile_sym_t;
+
+typedef struct {
+    uint32_t pa_addr;   // Amiga address
+    uint32_t pa_count;  // Fetches of address
+} profile_addr_t;
+
+static int
+profile_sym_cmp_addr(const void *arg1, const void *arg2)
+{
+    const profile_sym_t *sym1 = arg1;
+    const profile_sym_t *sym2 = arg2;
+    return ((sym1->ps_addr > sym2->ps_addr) - (sym1->ps_addr < sym2->ps_addr));
+}
+
+static int
+profile_sym_cmp_count(const void *arg1, const void *arg2)
+{
+    const profile_sym_t *sym1 = arg1;
+    const profile_sym_t *sym2 = arg2;
+    return ((sym1->ps_count < sym2->ps_count) -
+            (sym1->ps_count > sym2->ps_count));
+}
+
+static int
+profile_addr_cmp_count(const void *arg1, const void *arg2)
+{
+    const profile_addr_t *pa1 = arg1;
+    const profile_addr_t *pa2 = arg2;
+    return ((pa1->pa_count < pa2->pa_count) -
+            (pa1->pa_count > pa2->pa_count));
+}
+
+/*
+ * profile_map_load() reads a symbol map file, returning an array of
+ *                    symbols sorted by address.
+ *
+ * @param  [in]  filename - The map file to read.
+ * @param  [out] count    - The number of symbols in the returned array.
+ *
+ * @return       Array of symbols.
+ * @exit         EXIT_FAILURE - The program will terminate on file access error.
+ */
+static profile_sym_t *
+profile_map_load(const char *filename, uint *count)
+{
+    FILE          *fp;
+    profile_sym_t *syms = NULL;
+    uint           alloced = 0;
+    uint           nsyms = 0;
+    char           line[512];
+    char           name[256];
+    uint           addr;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL)
+        err(EXIT_FAILURE, "Failed to open %s", filename);
+
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        if (sscanf(line, "%x %255s", &addr, name) != 2)
+            continue;
+        if (nsyms >= alloced) {
+            alloced = (alloced == 0) ? 256 : alloced * 2;
+            syms = realloc(syms, alloced * sizeof (*syms));
+            if (syms == NULL)
+                errx(EXIT_FAILURE, "Could not allocate %u symbols", alloced);
+        }
+        syms[nsyms].ps_addr  = addr;
+        syms[nsyms].ps_count = 0;
+        syms[nsyms].ps_name  = strdup(name);
+        nsyms++;
+    }
+    fclose(fp);
+    if (nsyms != 0)
+        qsort(syms, nsyms, sizeof (*syms), profile_sym_cmp_addr);
+    *count = nsyms;
+    return (syms);
+}
+
+/*
+ * profile_sym_find() returns the symbol containing the specified address,
+ *                    or NULL if the address precedes all symbols.
+ */
+static profile_sym_t *
+profile_sym_find(profile_sym_t *syms, uint nsyms, uint32_t addr)
+{
+    uint lo = 0;
+    uint hi = nsyms;
+
+    /* Find the last symbol with address <= addr */
+    while (lo < hi) {
+        uint mid = (lo + hi) / 2;
+        if (syms[mid].ps_addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return (NULL);
+    return (&syms[lo - 1]);
+}
+
+/*
+ * profile_stream() receives snoop frames from Kicksmash for the specified
+ *                  time, counting fetches of each ROM word address.
+ *
+ * @param  [out] counts   - Per ROM word address fetch counts.
+ * @param  [in]  msec     - Capture time in milliseconds.
+ * @param  [out] flags    - Accumulated SNOOP_FRAME_* flags of all frames.
+ *
+ * @return       Number of fetches captured, or -1 on stream error.
+ */
+static int64_t
+profile_stream(uint32_t *counts, uint msec, uint *flags)
+{
+    static uint8_t data[SNOOP_FRAME_DATA_MAX];
+    snoop_frame_t  sf;
+    struct timeval tv_end;
+    struct timeval tv_timeout;
+    int64_t        total = 0;
+    uint32_t       last = 0;
+    bool           stopping = FALSE;
+    int            rxlen;
+
+    if (send_cmd("snoop stream"))
+        return (-1);  // send_cmd() reported "timeout" in this case
+
+    *flags = 0;
+    calc_timeout_msec(&tv_end, msec);
+    while (1) {
+        if (!stopping && time_has_elapsed(&tv_end)) {
+            send_ll_str(" ");  // Any character ends the stream
+            stopping = TRUE;
+            calc_timeout_msec(&tv_timeout, 1000);
+        }
+        rxlen = receive_ll(&sf, sizeof (sf), 500, false);
+        if (rxlen == 0) {
+            /* Amiga might not be fetching from ROM */
+            if (stopping && time_has_elapsed(&tv_timeout)) {
+                printf("Timeout waiting for end of snoop stream\n");
+                return (-1);
+            }
+            continue;
+        }
+        if ((rxlen != sizeof (sf)) || (sf.sf_magic != SNOOP_FRAME_MAGIC) ||
+            (sf.sf_len > sizeof (data))) {
+            printf("Bad snoop frame header (%d bytes, magic %04x)\n",
+                   rxlen, sf.sf_magic);
+            discard_input(250);
+            return (-1);
+        }
+        if (receive_ll(data, sf.sf_len, 500, true) != sf.sf_len)
+            return (-1);
+        if (crc32(0, data, sf.sf_len) != sf.sf_crc) {
+            printf("Snoop frame CRC error\n");
+            send_ll_str(" ");
+            discard_input(250);
+            return (-1);
+        }
+        *flags |= sf.sf_flags;
+
+        uint pos = 0;
+        uint count;
+        for (count = 0; count < sf.sf_count; count++) {
+            uint32_t zz = 0;
+            uint     shift = 0;
+            uint8_t  byte;
+            do {
+                if (pos >= sf.sf_len) {
+                    printf("Snoop frame truncated\n");
+                    return (-1);
+                }
+                byte = data[pos++];
+                zz |= (uint32_t) (byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            last += (zz >> 1) ^ -(zz & 1);
+            counts[last & (PROFILE_ADDR_COUNT - 1)]++;
+        }
+        total += sf.sf_count;
+        if (sf.sf_flags & SNOOP_FRAME_END)
+            break;
+    }
+    discard_input(50);  // Discard command prompt
+    return (total);
+}
+
+/*
+ * profile_rom() captures Amiga fetches from Kickstart ROM for the
+ *               specified time, then reports the most frequently fetched
+ *               addresses and (if a symbol map is provided) functions.
+ *
+ * @param  [in]  msec       - Capture time in milliseconds.
+ * @param  [in]  mapfile    - Symbol map filename, or NULL.
+ * @param  [in]  report_max - Maximum number of entries to show.
+ *
+ * @return       0 - Success.
+ * @return       1 - Failure.
+ */
+static int
+profile_rom(uint msec, const char *mapfile, uint report_max)
+{
+    uint32_t       *counts;
+    profile_addr_t *addrs;
+    profile_sym_t  *syms = NULL;
+    profile_sym_t  *sym;
+    uint64_t        unknown = 0;
+    int64_t         total;
+    uint            nsyms = 0;
+    uint            naddrs = 0;
+    uint            flags;
+    uint            shift;
+    uint            pos;
+
+    if (mapfile != NULL)
+        syms = profile_map_load(mapfile, &nsyms);
+
+    counts = calloc(PROFILE_ADDR_COUNT, sizeof (*counts));
+    if (counts == NULL)
+        errx(EXIT_FAILURE, "Could not allocate %u byte buffer",
+             PROFILE_ADDR_COUNT * (uint) sizeof (*counts));
+
+    printf("Capturing ROM fetches for %u ms\n", msec);
+    total = profile_stream(counts, msec, &flags);
+    if (total < 0) {
+        free(counts);
+        return (1);
+    }
+    printf("Captured %jd fetches%s\n", (intmax_t) total,
+           (flags & SNOOP_FRAME_LOST) ? " (some captures were lost)" : "");
+    if (total == 0) {
+        free(counts);
+        return (0);
+    }
+
+    shift = (flags & SNOOP_FRAME_32BIT) ? 2 : 1;
+    for (pos = 0; pos < PROFILE_ADDR_COUNT; pos++)
+        if (counts[pos] != 0)
+            naddrs++;
+    addrs = malloc(naddrs * sizeof (*addrs));
+    if (addrs == NULL)
+        errx(EXIT_FAILURE, "Could not allocate %u addresses", naddrs);
+    naddrs = 0;
+    for (pos = 0; pos < PROFILE_ADDR_COUNT; pos++) {
+        if (counts[pos] == 0)
+            continue;
+        addrs[naddrs].pa_addr  = PROFILE_ROM_BASE +
+                                 ((pos << shift) & PROFILE_ROM_MASK);
+        addrs[naddrs].pa_count = counts[pos];
+        sym = profile_sym_find(syms, nsyms, addrs[naddrs].pa_addr);
+        if (sym != NULL)
+            sym->ps_count += counts[pos];
+        else
+            unknown += counts[pos];
+        naddrs++;
+    }
+    free(counts);
+    qsort(addrs, naddrs, sizeof (*addrs), profile_addr_cmp_count);
+
+    printf("\n   Fetches    Pct  Address  Function\n");
+    for (pos = 0; (pos < naddrs) && (pos < report_max); pos++) {
+        printf("%10u %5.1f%%  %06x", addrs[pos].pa_count,
+               addrs[pos].pa_count * 100.0 / total, addrs[pos].pa_addr);
+        sym = profile_sym_find(syms, nsyms, addrs[pos].pa_addr);
+        if (sym != NULL)
+            printf("   %s+0x%x", sym->ps_name,
+                   addrs[pos].pa_addr - sym->ps_addr);
+        printf("\n");
+    }
+    free(addrs);
+
+    if (nsyms != 0) {
+        qsort(syms, nsyms, sizeof (*syms), profile_sym_cmp_count);
+        printf("\n   Fetches    Pct  Function\n");
+        for (pos = 0; (pos < nsyms) && (pos < report_max); pos++) {
+            if (syms[pos].ps_count == 0)
+                break;
+            printf("%10ju %5.1f%%  %s\n", (uintmax_t) syms[pos].ps_count,
+                   syms[pos].ps_count * 100.0 / total, syms[pos].ps_name);
+        }
+        if (unknown != 0) {
+            printf("%10ju %5.1f%%  (before first symbol)\n",
+                   (uintmax_t) unknown, unknown * 100.0 / total);
+        }
+        for (pos = 0; pos < nsyms; pos++)
+            free(syms[pos].ps_name);
+    }
+    free(syms);
+    return (0);
+}
+
+/*
+ * amiga_is_in_reset
+ * -----------------
+ * Returns 1 if the Amiga is in reset.
+ * Returns 0 if the Amiga is not in reset.
+ * Returns -1 if there was an error communicating with Kicksmash.
+ */
+static int
+amiga_is_in_reset(void)
+{
+    char cmd_output[100];
+    int  rxcount;
+    if (send_cmd("prom id"))
+        return (-1); // "timeout" was reported in this case
+    if (recv_output(cmd_output, sizeof (cmd_output), &rxcount, 80))
+        return (-1); // "timeout" was reported in this case
+    if (rxcount == 0) {
+        printf("Receive timeout\n");
+        return (-1);
+    }
+    if (strstr(cmd_output, "not in reset") != NULL)
+        return (0);
+    return (1);
+}
+
+static int
+reset_amiga(int hold)
+{
     const char *cmd = hold ? "reset amiga hold" : "reset prom";
 
     if (send_cmd(cmd))
@@ -3587,6 +4554,7 @@ send_ks_cmd(uint cmd, void *txbuf, uint txlen, void *rxbuf, uint rxmax,
             uint *rxstatus, uint *rxlen, uint flags)
 {
     uint rc;
+    send_msg_flush();  // Collect status of any message frames in flight
     rc = send_ks_cmd_core(cmd, txlen, txbuf);
     if (rc != 0)
         return (rc);
@@ -3616,6 +4584,7 @@ show_ks_inquiry(void)
            id.si_ks_time[0], id.si_ks_time[1], id.si_ks_time[2]);
     printf("  USB %08x  Serial \"%s\"  Name \"%s\"\n",
            SWAP32(id.si_usbid), id.si_serial, id.si_name);
+    ks_features = SWAP16(id.si_features);
     printf("  Mode: %s\n",
            (id.si_mode == 0) ? "32-bit" :
            (id.si_mode == 1) ? "16-bit" :
@@ -3649,12 +4618,123 @@ mem16_swap(void *buf, uint len)
     }
 }
 
-#define SEND_MSG_MAX 2000
+#define SEND_MSG_MAX          KM_UTOA_FRAME_MAX
+#define SEND_MSG_INFLIGHT_MAX 4032  // Kicksmash console input ring is 4 KB
+
+/*
+ * KS_CMD_MSG_SEND frames which have been sent, but whose status reply has
+ * not yet been collected. The reader thread buffers those replies. The
+ * total size of frames in flight must fit in the Kicksmash console input
+ * ring, which discards data on overflow. Frames of a message whose reply
+ * was deferred (see msg_defer_bytes) are marked deferred; their status is
+ * only reported.
+ */
+static uint16_t msg_inflight_len[32];
+static uint8_t  msg_inflight_deferred[32];
+static uint     msg_inflight_cons  = 0;
+static uint     msg_inflight_count = 0;
+static uint     msg_inflight_bytes = 0;
+
+/*
+ * Bytes of USB -> Amiga buffer space known to be free in each message
+ * channel, so which may be sent without waiting for status. Set when a
+ * batch of Amiga messages is received and consumed by send_msg() as
+ * replies are sent. Since only this program fills that buffer, the space
+ * remains free until replies are sent.
+ */
+static uint     msg_defer_bytes[KS_MSG_CHANNELS];
+
+/*
+ * Message channel used by send_msg() and recv_msg(). Replies are sent
+ * on the channel of the message being processed.
+ */
+static uint     msg_chan = 0;
+
+/*
+ * send_msg_collect
+ * ----------------
+ * Collects the status reply of the oldest KS_CMD_MSG_SEND frame still in
+ * flight. The first failing status of a non-deferred frame is retained in
+ * *status.
+ */
+static uint
+send_msg_collect(uint *status)
+{
+    uint rc;
+    uint txstatus = 0;
+    uint pos = msg_inflight_cons;
+
+    msg_inflight_cons = (pos + 1) % ARRAY_SIZE(msg_inflight_len);
+    msg_inflight_count--;
+    msg_inflight_bytes -= msg_inflight_len[pos];
+    rc = recv_ks_reply_core(NULL, 0, 0, &txstatus, NULL);
+    if (msg_inflight_deferred[pos]) {
+        if ((rc != 0) || (txstatus != 0)) {
+            printf("KS deferred send_msg failure: %d status=%02x\n",
+                   rc, txstatus);
+        }
+        return (0);
+    }
+    if ((rc == 0) && (*status == 0))
+        *status = txstatus;
+    return (rc);
+}
+
+/*
+ * send_msg_flush
+ * --------------
+ * Collects the status of all KS_CMD_MSG_SEND frames still in flight. This
+ * must be done before any other Kicksmash command is issued.
+ */
+static void
+send_msg_flush(void)
+{
+    uint status = 0;
+
+    while (msg_inflight_count > 0)
+        (void) send_msg_collect(&status);
+}
+
+/*
+ * send_msg_frame
+ * --------------
+ * Sends a single KS_CMD_MSG_SEND frame, first collecting status of older
+ * frames as needed to make room for it.
+ */
+static uint
+send_msg_frame(void *buf, uint len, uint *status)
+{
+    uint fsize = ((len + 1) & ~1) + KS_HDR_AND_CRC_LEN;
+    uint rc;
+
+    while ((msg_inflight_count > 0) &&
+           ((msg_inflight_count >= ARRAY_SIZE(msg_inflight_len)) ||
+            (msg_inflight_bytes + fsize > SEND_MSG_INFLIGHT_MAX))) {
+        rc = send_msg_collect(status);
+        if (rc != 0)
+            return (rc);
+    }
+    rc = send_ks_cmd_core(KS_CMD_MSG_SEND | KS_MSG_CHANNEL(msg_chan),
+                          len, buf);
+    if (rc == 0) {
+        uint pos = (msg_inflight_cons + msg_inflight_count) %
+                   ARRAY_SIZE(msg_inflight_len);
+        msg_inflight_len[pos]      = fsize;
+        msg_inflight_deferred[pos] = 0;
+        msg_inflight_count++;
+        msg_inflight_bytes += fsize;
+    }
+    return (rc);
+}
 
 /*
  * send_msg
  * --------
- * Sends a message to the remote Amiga
+ * Sends a message to the remote Amiga. Messages larger than SEND_MSG_MAX
+ * are sent as several frames, which are pipelined (see msg_inflight_*).
+ * If the message fits in USB -> Amiga buffer space known to be free, its
+ * status is not waited for, allowing replies to a batch of Amiga messages
+ * to be sent together.
  */
 static uint
 send_msg(void *buf, uint len, uint *status)
@@ -3665,12 +4745,17 @@ send_msg(void *buf, uint len, uint *status)
     uint bodylen;
     uint pos;
     uint bodylen_rounded;
+    uint frames = 0;
+    uint fbytes = 0;
 
+    *status = 0;
     mem16_swap(buf, len);
     if (sendlen > SEND_MSG_MAX)
         sendlen = SEND_MSG_MAX;
-    rc = send_ks_cmd(KS_CMD_MSG_SEND, buf, sendlen, NULL, 0, status, NULL, 0);
+    rc = send_msg_frame(buf, sendlen, status);
     if (rc == 0) {
+        frames++;
+        fbytes += ((sendlen + 1) & ~1) + KS_HDR_AND_CRC_LEN;
         pos = sendlen;
         if (pos < len) {
             /*
@@ -3700,8 +4785,10 @@ send_msg(void *buf, uint len, uint *status)
             do {
                 /* Wait for space */
                 smash_msg_info_t mi;
-                rc = send_ks_cmd(KS_CMD_MSG_INFO, NULL, 0, &mi, sizeof (mi),
-                                 status, NULL, 0);
+                uint mistatus;
+                rc = send_ks_cmd(KS_CMD_MSG_INFO | KS_MSG_CHANNEL(msg_chan),
+                                 NULL, 0, &mi, sizeof (mi),
+                                 &mistatus, NULL, 0);
                 mi.smi_utoa_avail = SWAP16(mi.smi_utoa_avail);
                 if (mi.smi_utoa_avail >= sendlen)
                     break;
@@ -3715,12 +4802,13 @@ send_msg(void *buf, uint len, uint *status)
                 break;
             }
 #endif
-            rc = send_ks_cmd(KS_CMD_MSG_SEND, msgbuf, sendlen, NULL, 0,
-                             status, NULL, 0);
+            rc = send_msg_frame(msgbuf, sendlen, status);
             if (rc != 0) {
                 printf("send msg failed at %x of %x\n", pos, len);
                 break;
             }
+            frames++;
+            fbytes += ((sendlen + 1) & ~1) + KS_HDR_AND_CRC_LEN;
             pos += bodylen;
 #undef DEBUG_SEND_MSG
 #ifdef DEBUG_SEND_MSG
@@ -3730,21 +4818,198 @@ send_msg(void *buf, uint len, uint *status)
         }
     }
 
+    if ((rc == 0) && (*status == 0) && (fbytes <= msg_defer_bytes[msg_chan])) {
+        /*
+         * The message fits in buffer space known to be free, so status
+         * is not needed now. Mark its frames which are still in flight
+         * as deferred (any older frames in flight are already deferred).
+         */
+        uint cur = 0;
+        msg_defer_bytes[msg_chan] -= fbytes;
+        if (frames < msg_inflight_count)
+            cur = msg_inflight_count - frames;
+        for (; cur < msg_inflight_count; cur++) {
+            msg_inflight_deferred[(msg_inflight_cons + cur) %
+                                  ARRAY_SIZE(msg_inflight_len)] = 1;
+        }
+    } else {
+        /* Collect status of this message's frames still in flight */
+        while (msg_inflight_count > 0) {
+            uint trc = send_msg_collect(status);
+            if (rc == 0)
+                rc = trc;
+        }
+    }
+
     mem16_swap(buf, len);
     return (rc);
 }
 
+/*
+ * Messages from the Amiga which were received together by recv_msg_all(),
+ * but not yet consumed by recv_msg(), by message channel.
+ */
+typedef struct rx_msg rx_msg_t;
+struct rx_msg {
+    rx_msg_t *rm_next;
+    uint      rm_status;
+    uint      rm_len;
+    uint8_t   rm_data[];
+};
+static rx_msg_t *rx_msg_head[KS_MSG_CHANNELS];
+static rx_msg_t *rx_msg_tail[KS_MSG_CHANNELS];
+
+/*
+ * rx_msg_enqueue
+ * --------------
+ * Adds a received (already byte-swapped) message to the rx_msg queue
+ * of the specified channel.
+ */
+static void
+rx_msg_enqueue(uint chan, uint status, const uint8_t *data, uint len)
+{
+    rx_msg_t *rm = malloc(sizeof (*rm) + len);
+
+    if (rm == NULL)
+        errx(EXIT_FAILURE, "Could not allocate %u bytes", len);
+    rm->rm_next   = NULL;
+    rm->rm_status = status;
+    rm->rm_len    = len;
+    if (len != 0)
+        memcpy(rm->rm_data, data, len);
+    if (rx_msg_tail[chan] == NULL)
+        rx_msg_head[chan] = rm;
+    else
+        rx_msg_tail[chan]->rm_next = rm;
+    rx_msg_tail[chan] = rm;
+}
+
+/*
+ * recv_msg_batch
+ * --------------
+ * Receives pending messages of a channel from the remote Amiga in a
+ * single transfer, adding them to the channel's rx_msg queue. The free
+ * space reported in the USB -> Amiga buffer allows replies to this batch
+ * to be sent without waiting for status (see send_msg()).
+ */
+static uint
+recv_msg_batch(uint chan)
+{
+    smash_msg_batch_t mb;
+    uint8_t           rxbuf[4096];
+    uint16_t          limit = SWAP16(sizeof (rxbuf));
+    uint              status;
+    uint              rxlen;
+    uint              count;
+    uint              rc;
+
+    rc = send_ks_cmd(KS_CMD_MSG_RECEIVE | KS_MSG_RX_BATCH |
+                     KS_MSG_CHANNEL(chan), &limit, sizeof (limit),
+                     &mb, sizeof (mb), &status, &rxlen, 0);
+    if (rc != 0)
+        return (rc);
+    if (status != KS_STATUS_OK) {
+        /* Such as KS_STATUS_LOCKED: pass on to the caller */
+        rx_msg_enqueue(chan, status, NULL, 0);
+        return (0);
+    }
+    if (rxlen < sizeof (mb))
+        return (MSG_STATUS_BAD_LENGTH);
+
+    for (count = SWAP16(mb.smb_count); count > 0; count--) {
+        rc = recv_ks_reply_core(rxbuf, sizeof (rxbuf), 0, &status, &rxlen);
+        if (rc != 0)
+            return (rc);
+        mem16_swap(rxbuf, rxlen);
+        rx_msg_enqueue(chan, status, rxbuf, rxlen);
+    }
+
+    /* Replies to this batch may use this space without awaiting status */
+    msg_defer_bytes[chan] = SWAP16(mb.smb_utoa_avail);
+    return (0);
+}
+
+/*
+ * recv_msg_all
+ * ------------
+ * Receives all pending messages of a channel from the remote Amiga in one
+ * exchange, adding them to the channel's rx_msg queue. The Kicksmash sends
+ * one reply per message, ending with KS_STATUS_NODATA. An error reply
+ * (such as KS_STATUS_LOCKED) is the only reply, and is queued for the
+ * caller.
+ */
+static uint
+recv_msg_all(uint chan)
+{
+    uint8_t   rxbuf[4096];
+    uint      status;
+    uint      rxlen;
+    uint      rc;
+
+    send_msg_flush();
+    msg_defer_bytes[chan] = 0;
+    if (ks_features & KS_FEATURE_MSG_RX_BATCH)
+        return (recv_msg_batch(chan));
+
+    rc = send_ks_cmd_core(KS_CMD_MSG_RECEIVE | KS_MSG_RX_ALL |
+                          KS_MSG_CHANNEL(chan), 0, NULL);
+    while (rc == 0) {
+        rc = recv_ks_reply_core(rxbuf, sizeof (rxbuf), 0, &status, &rxlen);
+        if (rc != 0)
+            break;
+        if (status == KS_STATUS_NODATA)
+            break;
+        mem16_swap(rxbuf, rxlen);
+        rx_msg_enqueue(chan, status, rxbuf, rxlen);
+        if ((status == KS_STATUS_LOCKED) || (status == KS_STATUS_CRC))
+            break;  // Only reply; nothing else follows
+    }
+    return (rc);
+}
+
 /*
  * recv_msg
  * --------
- * Receives a message from the remote Amiga
+ * Receives a message from the remote Amiga on the current message channel.
+ * If the Kicksmash supports it, all pending messages are fetched at once
+ * and then handed out from the local queue.
  */
 static uint
 recv_msg(void *buf, uint bufsize, uint *rx_status, uint *rx_len)
 {
-    uint rc;
-    rc = send_ks_cmd(KS_CMD_MSG_RECEIVE, NULL, 0, buf, bufsize,
-                     rx_status, rx_len, 0);
+    uint      rc;
+    uint      chan = msg_chan;
+    rx_msg_t *rm;
+
+    if ((rx_msg_head[chan] == NULL) &&
+        (ks_features & (KS_FEATURE_MSG_RX_ALL | KS_FEATURE_MSG_RX_BATCH))) {
+        rc = recv_msg_all(chan);
+        if (rc != 0)
+            return (rc);
+        if (rx_msg_head[chan] == NULL) {
+            *rx_status = KS_STATUS_NODATA;
+            *rx_len    = 0;
+            return (0);
+        }
+    }
+    if ((rm = rx_msg_head[chan]) != NULL) {
+        rx_msg_head[chan] = rm->rm_next;
+        if (rx_msg_head[chan] == NULL)
+            rx_msg_tail[chan] = NULL;
+        if (rm->rm_len > bufsize) {
+            printf("message len 0x%x > buflen 0x%x\n", rm->rm_len, bufsize);
+            free(rm);
+            return (MSG_STATUS_BAD_LENGTH);
+        }
+        memcpy(buf, rm->rm_data, rm->rm_len);
+        *rx_status = rm->rm_status;
+        *rx_len    = rm->rm_len;
+        free(rm);
+        return (0);
+    }
+
+    rc = send_ks_cmd(KS_CMD_MSG_RECEIVE | KS_MSG_CHANNEL(chan), NULL, 0,
+                     buf, bufsize, rx_status, rx_len, 0);
     if (rc == 0)
         mem16_swap(buf, *rx_len);
     return (rc);
@@ -3937,53 +5202,298 @@ get_rel_trim_dotdot:
 }
 
 /*
- * merge_host_paths is used to build a final path for file open.
- * It takes two paths and simply merges them together, inserting
- * a slash in the middle as appropriate.
+ * merge_host_paths is used to build a final path for file open.
+ * It takes two paths and simply merges them together, inserting
+ * a slash in the middle as appropriate.
+ */
+char *
+merge_host_paths(const char *base, const char *append)
+{
+    char pathbuf[KS_PATH_MAX];
+    uint len = strlen(base);
+    if (len == 0)                   // no base
+        return (strdup(append));
+    if (strlen(append) == 0)        // no append
+        return (strdup(base));
+    if (append[0] == '/')           // append starts at root directory
+        return (strdup(append));
+    strcpy(pathbuf, base);
+    if (base[len - 1] != '/') {
+        if (base[len - 1] != ':') {
+            /* Volume name plus some part of path; add a slash */
+            pathbuf[len++] = '/';
+        } else {
+            /* Possiblly just the volume name */
+            const char *ptr;
+            /* Is the name just the volume root? */
+            for (ptr = &base[len - 2]; ptr > base; ptr--)
+                if (*ptr == ':') {
+                    /* More than one colon present; add a slash */
+                    pathbuf[len++] = '/';
+                }
+        }
+    }
+    strcpy(pathbuf + len, append);
+
+#ifdef __MINGW32__
+    /* Windows does not like to stat directory paths which end in '/' */
+    char *ptr = pathbuf + strlen(pathbuf) - 1;
+    if (*ptr == '/')
+        *ptr = '\0';
+#endif
+
+    return (strdup(pathbuf));
+}
+
+/*
+ * Case-insensitive name index
+ *
+ * AmigaDOS names are case-insensitive, but most host filesystems are
+ * not. When a path does not exist with the exact case given by the
+ * Amiga, each path element is looked up in a per-directory index of
+ * case-folded names. Indexes are built on first use, kept for the most
+ * recently used directories, and rebuilt when a directory's modification
+ * time changes.
+ */
+#define NAME_INDEX_DIRS 16
+
+typedef struct name_ent name_ent_t;
+typedef struct name_ent {
+    name_ent_t *ne_next;     // Next in hash chain
+    char        ne_name[];   // Host name (actual case)
+} name_ent_t;
+
+typedef struct {
+    char        *ni_dir;     // Host directory path
+    time_t       ni_mtime;   // Directory modification time when built
+    uint         ni_racy;    // Directory changed in the second of build
+    uint         ni_used;    // LRU sequence
+    uint         ni_size;    // Hash table size (power of 2)
+    name_ent_t **ni_hash;    // Hash table
+} name_index_t;
+
+static name_index_t name_index[NAME_INDEX_DIRS];
+static uint         name_index_seq;
+
+/* Amiga (ISO 8859-1) case folding, as performed by utility.library */
+static uint8_t
+amiga_toupper(uint8_t ch)
+{
+    if (((ch >= 'a') && (ch <= 'z')) ||
+        ((ch >= 0xe0) && (ch <= 0xfe) && (ch != 0xf7)))
+        return (ch - 0x20);
+    return (ch);
+}
+
+static uint
+name_fold_hash(const char *name)
+{
+    uint hash = 5381;
+    while (*name != '\0')
+        hash = hash * 33 + amiga_toupper(*(name++));
+    return (hash);
+}
+
+static int
+name_fold_match(const char *name1, const char *name2)
+{
+    while (amiga_toupper(*name1) == amiga_toupper(*name2)) {
+        if (*name1 == '\0')
+            return (1);
+        name1++;
+        name2++;
+    }
+    return (0);
+}
+
+static void
+name_index_free(name_index_t *ni)
+{
+    uint pos;
+    for (pos = 0; pos < ni->ni_size; pos++) {
+        name_ent_t *ent;
+        while ((ent = ni->ni_hash[pos]) != NULL) {
+            ni->ni_hash[pos] = ent->ne_next;
+            free(ent);
+        }
+    }
+    free(ni->ni_hash);
+    free(ni->ni_dir);
+    memset(ni, 0, sizeof (*ni));
+}
+
+static void
+name_index_build(name_index_t *ni, const char *dir, time_t mtime)
+{
+    struct dirent *dp;
+    DIR           *dirp;
+    uint           count = 0;
+
+    ni->ni_dir   = strdup(dir);
+    ni->ni_mtime = mtime;
+    ni->ni_racy  = (mtime >= time(NULL));
+    ni->ni_size  = 64;
+
+    if ((dirp = opendir(dir)) == NULL)
+        return;
+    while (readdir(dirp) != NULL)
+        count++;
+    while (ni->ni_size < count * 2)
+        ni->ni_size <<= 1;
+    ni->ni_hash = calloc(ni->ni_size, sizeof (*ni->ni_hash));
+    if (ni->ni_hash == NULL) {
+        ni->ni_size = 0;
+        closedir(dirp);
+        return;
+    }
+
+    rewinddir(dirp);
+    while ((dp = readdir(dirp)) != NULL) {
+        uint        len = strlen(dp->d_name);
+        uint        hash;
+        name_ent_t *ent;
+
+        if (IS_DOT(dp->d_name) || IS_DOT_DOT(dp->d_name))
+            continue;
+        ent = malloc(sizeof (*ent) + len + 1);
+        if (ent == NULL)
+            break;
+        memcpy(ent->ne_name, dp->d_name, len + 1);
+        hash = name_fold_hash(dp->d_name) & (ni->ni_size - 1);
+        ent->ne_next = ni->ni_hash[hash];
+        ni->ni_hash[hash] = ent;
+    }
+    closedir(dirp);
+}
+
+/*
+ * name_index_lookup
+ * -----------------
+ * Returns the actual host name of the entry in the specified directory
+ * which matches <name> without regard to case, or NULL if not present.
+ */
+static const char *
+name_index_lookup(const char *dir, const char *name)
+{
+    name_index_t *ni;
+    name_index_t *victim = &name_index[0];
+    name_ent_t   *ent;
+    struct stat   st;
+    uint          pos;
+
+    if (stat(dir, &st) != 0)
+        return (NULL);
+
+    for (pos = 0; pos < NAME_INDEX_DIRS; pos++) {
+        ni = &name_index[pos];
+        if ((ni->ni_dir != NULL) && (strcmp(ni->ni_dir, dir) == 0))
+            break;
+        if (ni->ni_used < victim->ni_used)
+            victim = ni;
+    }
+    if (pos == NAME_INDEX_DIRS) {
+        ni = victim;
+        name_index_free(ni);
+        name_index_build(ni, dir, st.st_mtime);
+    } else if ((ni->ni_mtime != st.st_mtime) || ni->ni_racy) {
+        name_index_free(ni);
+        name_index_build(ni, dir, st.st_mtime);
+    }
+    ni->ni_used = ++name_index_seq;
+
+    if (ni->ni_size == 0)
+        return (NULL);
+    ent = ni->ni_hash[name_fold_hash(name) & (ni->ni_size - 1)];
+    for (; ent != NULL; ent = ent->ne_next)
+        if (name_fold_match(ent->ne_name, name))
+            return (ent->ne_name);
+    return (NULL);
+}
+
+/*
+ * host_path_fix_case
+ * ------------------
+ * If the specified host path does not exist, attempt to correct the case
+ * of each path element following the volume base path, using the name
+ * index. Elements which can not be found are left unchanged (the final
+ * element might be a file about to be created). If fix_last is zero, the
+ * final element is never changed, which is needed for the target of a
+ * case-only rename. Returns either the original path or a newly allocated
+ * replacement (the original is freed).
  */
-char *
-merge_host_paths(const char *base, const char *append)
+static char *
+host_path_fix_case(const char *base, char *path, uint fix_last)
 {
-    char pathbuf[KS_PATH_MAX];
-    uint len = strlen(base);
-    if (len == 0)                   // no base
-        return (strdup(append));
-    if (strlen(append) == 0)        // no append
-        return (strdup(base));
-    if (append[0] == '/')           // append starts at root directory
-        return (strdup(append));
-    strcpy(pathbuf, base);
-    if (base[len - 1] != '/') {
-        if (base[len - 1] != ':') {
-            /* Volume name plus some part of path; add a slash */
-            pathbuf[len++] = '/';
+    struct stat st;
+    char        fixed[KS_PATH_MAX];
+    char        dir[KS_PATH_MAX];
+    uint        baselen = strlen(base);
+    uint        len = strlen(path);
+    uint        pos;
+    uint        changed = 0;
+
+    if ((lstat(path, &st) == 0) || (len >= sizeof (fixed)) ||
+        (strncmp(path, base, baselen) != 0)) {
+        return (path);
+    }
+    memcpy(fixed, path, len + 1);
+
+    for (pos = baselen; fixed[pos] != '\0'; ) {
+        const char *actual;
+        char       *comp;
+        char       *end;
+        char        save;
+        uint        dlen = pos;
+
+        if (fixed[pos] == '/') {
+            pos++;
+            continue;
+        }
+        comp = fixed + pos;
+        end  = strchr(comp, '/');
+        if (end == NULL)
+            end = comp + strlen(comp);
+        if ((*end == '\0') && (fix_last == 0))
+            break;  // Leave destination name as specified
+
+        /* Directory holding this path element */
+        while ((dlen > 1) && (fixed[dlen - 1] == '/'))
+            dlen--;
+        if (dlen == 0) {
+            strcpy(dir, ".");
         } else {
-            /* Possiblly just the volume name */
-            const char *ptr;
-            /* Is the name just the volume root? */
-            for (ptr = &base[len - 2]; ptr > base; ptr--)
-                if (*ptr == ':') {
-                    /* More than one colon present; add a slash */
-                    pathbuf[len++] = '/';
-                }
+            memcpy(dir, fixed, dlen);
+            dir[dlen] = '\0';
+        }
+
+        save = *end;
+        *end = '\0';
+        actual = name_index_lookup(dir, comp);
+        if ((actual != NULL) && (strcmp(actual, comp) != 0)) {
+            memcpy(comp, actual, end - comp);  // Same length
+            changed = 1;
         }
+        *end = save;
+        if (actual == NULL)
+            break;  // No such path element
+        pos = end - fixed;
     }
-    strcpy(pathbuf + len, append);
 
-#ifdef __MINGW32__
-    /* Windows does not like to stat directory paths which end in '/' */
-    char *ptr = pathbuf + strlen(pathbuf) - 1;
-    if (*ptr == '/')
-        *ptr = '\0';
+    if (changed == 0)
+        return (path);
+#ifdef CASE_DEBUG
+    fsprintf("case fix %s -> %s\n", path, fixed);
 #endif
-
-    return (strdup(pathbuf));
+    free(path);
+    return (strdup(fixed));
 }
 
 /*
  * make_host_path is used to build a final path for file open.
  * It takes the volume path and simply concatenates the file
- * path, inserting a slash in the middle as appropriate.
+ * path, inserting a slash in the middle as appropriate. If the
+ * resulting path does not exist, a case-insensitive match of
+ * the path elements is attempted.
  */
 char *
 make_host_path(amiga_vol_t *vol, const char *append)
@@ -3991,7 +5501,31 @@ make_host_path(amiga_vol_t *vol, const char *append)
     if (vol == NULL)
         return (strdup(append));
 
-    return (merge_host_paths(vol->av_path, append));
+    return (host_path_fix_case(vol->av_path,
+                               merge_host_paths(vol->av_path, append), 1));
+}
+
+/*
+ * make_host_rename_path is like make_host_path, but for the target of a
+ * rename. If the target names the same object as path_old without regard
+ * to case, this is a case-only rename, so the final element is used as
+ * specified. Otherwise, the final element is matched without regard to
+ * case like any other path, so an existing entry is replaced.
+ */
+static char *
+make_host_rename_path(amiga_vol_t *vol, const char *append,
+                      const char *path_old)
+{
+    char *path;
+
+    if (vol == NULL)
+        return (strdup(append));
+
+    path = host_path_fix_case(vol->av_path,
+                              merge_host_paths(vol->av_path, append), 0);
+    if (name_fold_match(path, path_old))
+        return (path);
+    return (host_path_fix_case(vol->av_path, path, 1));
 }
 
 char *
@@ -4412,6 +5946,268 @@ amiga_perms_from_str(const char *aperms)
     return (mask);
 }
 
+/*
+ * UAE metadata (.uaem) sidecar cache
+ *
+ * WinUAE and FS-UAE store Amiga protection bits, date, and comment for
+ * a host file "name" in a text file "name.uaem" in the same directory:
+ *     ----rwed 2024-01-31 12:34:56.78 Optional comment
+ * Rather than opening a sidecar for every directory entry, all sidecars
+ * of the most recently listed directory are loaded in a single scan and
+ * held in a hash table keyed by base name. The table is rebuilt when the
+ * directory's modification time changes. Since a sidecar rewritten in
+ * place does not change the directory, each entry also records its
+ * sidecar's modification time, which is checked on lookup. A directory
+ * or sidecar read in the same second as its modification time may have
+ * changed again unnoticed, so it is re-read on next use.
+ */
+#define UAEM_HASH_SIZE    256
+#define UAEM_COMMENT_MAX  80   // Including NIL, matches fib_Comment
+
+typedef struct uaem_ent uaem_ent_t;
+typedef struct uaem_ent {
+    uaem_ent_t *ue_next;       // Next in hash chain
+    time_t      ue_smtime;     // Sidecar modification time when read
+    uint        ue_racy;       // Sidecar changed in the second it was read
+    uint        ue_perms;      // Amiga protection bits, 0xffffffff=invalid
+    uint32_t    ue_mtime;      // Amiga local time, 0 if not specified
+    char        ue_comment[UAEM_COMMENT_MAX];
+    char        ue_name[];     // Base name (without .uaem)
+} uaem_ent_t;
+
+static struct {
+    char       *uc_dir;        // Host directory path of cached entries
+    time_t      uc_mtime;      // Directory modification time when loaded
+    uint        uc_racy;       // Directory changed in the second of load
+    uaem_ent_t *uc_hash[UAEM_HASH_SIZE];
+} uaem_cache;
+
+static uint
+uaem_hash(const char *name, uint len)
+{
+    uint hash = 5381;
+    while (len-- > 0)
+        hash = hash * 33 + (uint8_t) *(name++);
+    return (hash % UAEM_HASH_SIZE);
+}
+
+static void
+uaem_cache_flush(void)
+{
+    uint pos;
+    for (pos = 0; pos < UAEM_HASH_SIZE; pos++) {
+        uaem_ent_t *ent;
+        while ((ent = uaem_cache.uc_hash[pos]) != NULL) {
+            uaem_cache.uc_hash[pos] = ent->ue_next;
+            free(ent);
+        }
+    }
+    free(uaem_cache.uc_dir);
+    uaem_cache.uc_dir = NULL;
+}
+
+/*
+ * uaem_parse_time
+ * ---------------
+ * Converts a sidecar "YYYY-MM-DD HH:MM:SS.cc" local date and time to
+ * seconds since 1970, in the same local-offset form as get_localtime().
+ */
+static uint32_t
+uaem_parse_time(const char *f_date, const char *f_time)
+{
+    int  year, mon, day, hour, min, sec;
+    int  era;
+    uint yoe, doy, doe;
+    int  days;
+
+    if ((sscanf(f_date, "%d-%d-%d", &year, &mon, &day) != 3) ||
+        (sscanf(f_time, "%d:%d:%d", &hour, &min, &sec) != 3) ||
+        (mon < 1) || (mon > 12) || (day < 1) || (day > 31) || (year < 1970))
+        return (0);
+
+    /* Days from civil date (proleptic Gregorian) */
+    year -= (mon <= 2);
+    era   = year / 400;
+    yoe   = year - era * 400;
+    doy   = (153 * (mon + ((mon > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+    doe   = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    days  = era * 146097 + (int) doe - 719468;
+
+    return ((uint32_t) days * 86400 + hour * 3600 + min * 60 + sec);
+}
+
+/*
+ * uaem_cache_load_file
+ * --------------------
+ * Reads a single sidecar into the cache. A sidecar which can not be
+ * parsed is still cached (as invalid), so that a later rewrite of it is
+ * noticed by its modification time.
+ */
+static void
+uaem_cache_load_file(const char *dir, const char *fname, uint baselen)
+{
+    uaem_ent_t *ent;
+    FILE       *fp;
+    struct stat st;
+    char        path[KS_PATH_MAX];
+    char        line[256];
+    char        f_perms[16];
+    char        f_date[12];
+    char        f_time[12];
+    int         cpos = 0;
+    uint        perms = 0xffffffff;
+    uint        hash;
+
+    snprintf(path, sizeof (path), "%s/%s", dir, fname);
+    if ((fp = fopen(path, "r")) == NULL)
+        return;
+    if (fstat(fileno(fp), &st) != 0) {
+        fclose(fp);
+        return;
+    }
+    if ((fgets(line, sizeof (line), fp) != NULL) &&
+        (sscanf(line, "%15s %11s %11s %n",
+                f_perms, f_date, f_time, &cpos) >= 3)) {
+        perms = amiga_perms_from_str(f_perms);
+    }
+    fclose(fp);
+
+    ent = malloc(sizeof (*ent) + baselen + 1);
+    if (ent == NULL)
+        return;
+    ent->ue_smtime = st.st_mtime;
+    ent->ue_racy   = (st.st_mtime >= time(NULL));
+    ent->ue_perms  = perms;
+    ent->ue_mtime  = 0;
+    ent->ue_comment[0] = '\0';
+    if (perms != 0xffffffff) {
+        ent->ue_mtime = uaem_parse_time(f_date, f_time);
+        line[strcspn(line, "\r\n")] = '\0';
+        if (cpos == 0)
+            cpos = strlen(line);  // No comment present
+        strncpy(ent->ue_comment, line + cpos, sizeof (ent->ue_comment) - 1);
+        ent->ue_comment[sizeof (ent->ue_comment) - 1] = '\0';
+    }
+    memcpy(ent->ue_name, fname, baselen);
+    ent->ue_name[baselen] = '\0';
+
+    hash = uaem_hash(fname, baselen);
+    ent->ue_next = uaem_cache.uc_hash[hash];
+    uaem_cache.uc_hash[hash] = ent;
+}
+
+/*
+ * uaem_cache_load
+ * ---------------
+ * Makes the sidecar cache current for the specified host directory,
+ * reading all .uaem files in that directory if the cache does not
+ * already hold them.
+ */
+static void
+uaem_cache_load(const char *dir)
+{
+    struct stat    st;
+    struct dirent *dp;
+    DIR           *dirp;
+
+    if (stat(dir, &st) != 0) {
+        uaem_cache_flush();
+        return;
+    }
+    if ((uaem_cache.uc_dir != NULL) && (strcmp(uaem_cache.uc_dir, dir) == 0) &&
+        (uaem_cache.uc_mtime == st.st_mtime) && !uaem_cache.uc_racy) {
+        return;  // Cache is current
+    }
+
+    uaem_cache_flush();
+    uaem_cache.uc_dir   = strdup(dir);
+    uaem_cache.uc_mtime = st.st_mtime;
+    uaem_cache.uc_racy  = (st.st_mtime >= time(NULL));
+
+    if ((dirp = opendir(dir)) == NULL)
+        return;
+    while ((dp = readdir(dirp)) != NULL) {
+        uint len = strlen(dp->d_name);
+        if ((len >= 6) && (strcmp(dp->d_name + len - 5, ".uaem") == 0))
+            uaem_cache_load_file(dir, dp->d_name, len - 5);
+    }
+    closedir(dirp);
+}
+
+/*
+ * uaem_cache_find
+ * ---------------
+ * Returns the cached sidecar entry for the specified base name, or NULL.
+ * If prevp is not NULL, it is assigned the link which points to the entry.
+ */
+static uaem_ent_t *
+uaem_cache_find(const char *name, uaem_ent_t ***prevp)
+{
+    uaem_ent_t **prev = &uaem_cache.uc_hash[uaem_hash(name, strlen(name))];
+    uaem_ent_t  *ent;
+
+    for (ent = *prev; ent != NULL; prev = &ent->ue_next, ent = *prev) {
+        if (strcmp(ent->ue_name, name) == 0) {
+            if (prevp != NULL)
+                *prevp = prev;
+            return (ent);
+        }
+    }
+    return (NULL);
+}
+
+/*
+ * uaem_lookup
+ * -----------
+ * Returns the UAE sidecar metadata for the specified host file path,
+ * or NULL if there is no sidecar for the file. The entry is re-read if
+ * its sidecar was modified since it was cached.
+ */
+static const uaem_ent_t *
+uaem_lookup(const char *host_path)
+{
+    const char  *name = strrchr(host_path, '/');
+    uaem_ent_t  *ent;
+    uaem_ent_t **prev;
+    struct stat  st;
+    char         dir[KS_PATH_MAX];
+    char         path[KS_PATH_MAX];
+    uint         dirlen;
+
+    if (name == NULL) {
+        strcpy(dir, ".");
+        name = host_path;
+    } else {
+        dirlen = name - host_path;
+        if (dirlen >= sizeof (dir))
+            return (NULL);
+        if (dirlen == 0)
+            dirlen = 1;  // Root directory
+        memcpy(dir, host_path, dirlen);
+        dir[dirlen] = '\0';
+        name++;
+    }
+    uaem_cache_load(dir);
+
+    ent = uaem_cache_find(name, &prev);
+    if (ent == NULL)
+        return (NULL);
+
+    snprintf(path, sizeof (path), "%s/%s.uaem", dir, name);
+    if ((stat(path, &st) != 0) || (st.st_mtime != ent->ue_smtime) ||
+        ent->ue_racy) {
+        /* Sidecar was rewritten or removed: re-read it */
+        *prev = ent->ue_next;
+        free(ent);
+        snprintf(path, sizeof (path), "%s.uaem", name);
+        uaem_cache_load_file(dir, path, strlen(name));
+        ent = uaem_cache_find(name, NULL);
+    }
+    if ((ent == NULL) || (ent->ue_perms == 0xffffffff))
+        return (NULL);
+    return (ent);
+}
+
 static uint
 errno_to_km_status(void)
 {
@@ -4890,11 +6686,12 @@ dir_read_common:
             char *host_path = NULL;
             char d_name[256];
             uint d_type = 0;
+            const uaem_ent_t *uaem = NULL;
 
             if (pos > hm_length)  // Safeguard
                 maxlen = 0;
-            if ((sizeof (*hm_dirent) +
-                 sizeof (d_name) + 2 > maxlen) && (pos > 0)) {
+            if ((sizeof (*hm_dirent) + sizeof (d_name) +
+                 UAEM_COMMENT_MAX + 2 > maxlen) && (pos > 0)) {
                 /*
                  * Next entry might not fit, so stop here.
                  *
@@ -4996,8 +6793,6 @@ dir_read_common:
                             skip = 1;
                         }
 
-#define IS_DOT(x)     (((x)[0] == '.') && ((x)[1] == '\0'))
-#define IS_DOT_DOT(x) (((x)[0] == '.') && ((x)[1] == '.') && ((x)[2] == '\0'))
                         /* Skip . and .. files */
                         if (IS_DOT(d_name) || IS_DOT_DOT(d_name)) {
                             skip = 1;
@@ -5105,7 +6900,6 @@ dir_read_common:
                     uint32_t time_a;
                     uint32_t time_c;
                     uint32_t time_m;
-                    char *host_path_uaem;
 
                     if (((he_mode & HM_MODE_NOFOLLOW) == 0) &&
                         (stat(host_path, &st) != 0)) {
@@ -5113,29 +6907,11 @@ dir_read_common:
                         fsprintf("stat %s failed\n", host_path);
                     }
 
-                    /* UAE support: check for .uaem file */
-                    host_path_uaem = malloc(strlen(host_path) + 6);
-                    if (host_path_uaem != NULL) {
-                        FILE *fp;
-                        strcpy(host_path_uaem, host_path);
-                        strcat(host_path_uaem, ".uaem");
-                        if ((fp = fopen(host_path_uaem, "r")) != NULL) {
-                            char f_perms[16];
-                            char f_date[12];
-                            char f_time[12];
-                            if (fscanf(fp, "%s %s %s",
-                                       f_perms, f_date, f_time) == 3) {
-                                fsprintf("%s UAEM perms=%s\n",
-                                         host_path_uaem, f_perms);
-                                amiga_perms = amiga_perms_from_str(f_perms);
-                                if (amiga_perms != 0xffffffff) {
-                                    st.st_mode = (st.st_mode & S_IFMT) |
-                                             host_perms_from_amiga(amiga_perms);
-                                }
-                            }
-                            fclose(fp);
-                        }
-                        free(host_path_uaem);
+                    /* UAE support: use .uaem sidecar metadata */
+                    uaem = uaem_lookup(host_path);
+                    if (uaem != NULL) {
+                        st.st_mode = (st.st_mode & S_IFMT) |
+                                     host_perms_from_amiga(uaem->ue_perms);
                     }
 
                     time_a = get_localtime(st.st_atime);
@@ -5160,6 +6936,11 @@ dir_read_common:
                     size_lo = (uint32_t) st.st_size;
                     hmd_type = st_mode_to_hm_type(st.st_mode);
                     amiga_perms = amiga_perms_from_host(st.st_mode);
+                    if (uaem != NULL) {
+                        amiga_perms = uaem->ue_perms;
+                        if (uaem->ue_mtime != 0)
+                            hm_dirent->hmd_mtime = SWAP32(uaem->ue_mtime);
+                    }
                 } else {
                     fsprintf("lstat %s failed\n", host_path);
                     size_hi = 0;
@@ -5197,6 +6978,11 @@ dir_read_common:
                 free(path);
 
                 nlen += llen;
+            } else if (uaem != NULL) {
+                /* Comment from UAE sidecar */
+                uint clen = strlen(uaem->ue_comment) + 1;
+                memcpy(nptr + nlen, uaem->ue_comment, clen);
+                nlen += clen;
             } else {
                 nptr[nlen++] = '\0';            // Comment NIL
             }
@@ -5689,7 +7475,8 @@ reply_rename_fail:
         hm->hm_hdr.km_status = KM_STATUS_INVALID;
         goto reply_rename_fail;
     }
-    path_new = make_host_path(phandle_new->he_avolume, apath_new);
+    path_new = make_host_rename_path(phandle_new->he_avolume, apath_new,
+                                     path_old);
 
     if (volume_get_by_path(path_old, 0) != NULL) {
         fsprintf("frename(%s) can't rename a volume\n", path_old);
@@ -6149,34 +7936,136 @@ process_msg(uint status, uint8_t *rxdata, uint rxlen)
     } while (retry-- > 0);
 }
 
+/*
+ * msg_is_bulk
+ * -----------
+ * Returns non-zero if the specified received message is a bulk file data
+ * request (KM_OP_FREAD or KM_OP_FWRITE), which may take much longer to
+ * service than a metadata request.
+ */
+static uint
+msg_is_bulk(const rx_msg_t *rm)
+{
+    const km_msg_hdr_t *km = (const km_msg_hdr_t *) rm->rm_data;
+
+    if (((rm->rm_status & ~KS_MSG_CHAN_MASK) != KS_CMD_MSG_SEND) ||
+        (rm->rm_len < sizeof (*km)))
+        return (0);
+    return ((km->km_op == KM_OP_FREAD) || (km->km_op == KM_OP_FWRITE));
+}
+
+/*
+ * msg_sched_next
+ * --------------
+ * Selects the message channel to serve next among the active channels,
+ * fetching pending messages as needed. A channel whose next message is a
+ * metadata request (such as KM_OP_FOPEN) is served before one whose next
+ * message is bulk file data, so that a long file copy does not hold off
+ * directory and open requests. Channels are otherwise served in turn.
+ * Messages within a channel are always handled in arrival order, which
+ * preserves ordering of requests against the same file handle.
+ *
+ * chans is the number of channels in use.
+ * active is a bitmask of channels which may have messages pending.
+ *     Channels found to have no message pending are removed.
+ * next is the channel to consider first, updated for the next call.
+ *
+ * Returns the channel to serve, or KS_MSG_CHANNELS if none is active.
+ */
+static uint
+msg_sched_next(uint chans, uint *active, uint *next)
+{
+    uint bulk = KS_MSG_CHANNELS;
+    uint pick = KS_MSG_CHANNELS;
+    uint count;
+    uint chan;
+
+    for (count = 0; count < chans; count++) {
+        chan = (*next + count) % chans;
+        if ((*active & BIT(chan)) == 0)
+            continue;
+        if ((ks_features &
+             (KS_FEATURE_MSG_RX_ALL | KS_FEATURE_MSG_RX_BATCH)) == 0) {
+            /* Can't look ahead; recv_msg() will receive one at a time */
+            pick = chan;
+            break;
+        }
+        if ((rx_msg_head[chan] == NULL) && (recv_msg_all(chan) != 0)) {
+            /* Let recv_msg() retry and report the failure */
+            pick = chan;
+            break;
+        }
+        if (rx_msg_head[chan] == NULL) {
+            *active &= ~BIT(chan);
+            continue;
+        }
+        if (!msg_is_bulk(rx_msg_head[chan])) {
+            pick = chan;
+            break;
+        }
+        if (bulk == KS_MSG_CHANNELS)
+            bulk = chan;
+    }
+    if (pick == KS_MSG_CHANNELS)
+        pick = bulk;
+    if (pick != KS_MSG_CHANNELS)
+        *next = (pick + 1) % chans;
+    return (pick);
+}
+
+/*
+ * handle_atou_messages
+ * --------------------
+ * Processes messages from the Amiga until none are pending. Where the
+ * Kicksmash supports message channels, channels are served one message
+ * at a time (see msg_sched_next()), so a long transfer on one channel
+ * (such as smashftp) does not hold off another (such as smashfs).
+ * Replies are sent in the order messages are processed. Returns the
+ * number of messages handled.
+ */
 static uint
 handle_atou_messages(void)
 {
+    static uint next = 0;
     uint8_t   rxdata[4096];
     uint      status;
     uint      rxlen;
     uint      rc;
+    uint      chan;
+    uint      chans = 1;
+    uint      active;
     uint      handled = 0;
 
     /*
      * Note that the length, command, and payload of messages received from
      * the Amiga are byte-swapped (B1 B0 B3 B2 B5 B4...). The send_msg()
      * and recv_msg() functions take care of this byte swapping.
+     *
+     * Where supported, recv_msg() fetches all pending messages as a batch,
+     * and send_msg() does not wait for status of each reply in that batch.
      */
-    while (1) {
+    if (ks_features & KS_FEATURE_MSG_CHANNELS)
+        chans = KS_MSG_CHANNELS;
+    active = BIT(chans) - 1;
+    next %= chans;
+
+    while ((chan = msg_sched_next(chans, &active, &next)) != KS_MSG_CHANNELS) {
+        msg_chan = chan;
         rc = recv_msg(rxdata, sizeof (rxdata), &status, &rxlen);
 
         if (rc != 0) {
             printf("KS recv_msg failure: %d (%s)\n", rc, smash_err(rc));
+            msg_chan = 0;
             return (rc);
         }
-        if (status == KS_CMD_MSG_SEND) {
+        if ((status & ~KS_MSG_CHAN_MASK) == KS_CMD_MSG_SEND) {
             process_msg(status, rxdata, rxlen);
             handled++;
-        } else if ((status == KS_STATUS_NODATA) ||
-                   (status == KS_STATUS_LOCKED)) {
-            break;
-        } else {
+            continue;
+        }
+        active &= ~BIT(chan);
+        if ((status != KS_STATUS_NODATA) &&
+            (status != KS_STATUS_LOCKED)) {
             printf("status=%04x len=%x", status, rxlen);
             if (rxlen > 0) {
                 uint pos;
@@ -6188,9 +8077,11 @@ handle_atou_messages(void)
                 }
             }
             printf("\n");
-            break;
         }
     }
+    msg_chan = 0;
+    send_msg_flush();
+    memset(msg_defer_bytes, 0, sizeof (msg_defer_bytes));
     return (handled);
 }
 
@@ -6204,6 +8095,8 @@ run_message_mode(void)
     uint curtick = 10;
     uint fstick = 0;
     uint count;
+    uint chan;
+    uint chans;
     uint16_t app_state = MSG_STATE_SERVICE_UP | MSG_STATE_HAVE_LOOPBACK;
     smash_msg_info_t mi;
 
@@ -6211,14 +8104,17 @@ run_message_mode(void)
         app_state |= MSG_STATE_HAVE_FILE;
 
     msgprintf("Message mode\n");
-    app_state_send[0] = SWAP16(0xffff);     // Affect all bits
-    app_state_send[1] = SWAP16(app_state);  // Message service up
 
     if (send_cmd("prom service"))
         return; // "timeout" was reported in this case
 
     show_ks_inquiry();
 
+    if (ks_features & KS_FEATURE_MSG_CHANNELS)
+        app_state |= MSG_STATE_HAVE_CHANNELS;
+    app_state_send[0] = SWAP16(0xffff);     // Affect all bits
+    app_state_send[1] = SWAP16(app_state);  // Message service up
+
     rc = send_ks_cmd(KS_CMD_MSG_STATE | KS_MSG_STATE_SET, app_state_send,
                      sizeof (app_state_send), buf, sizeof (buf), &status,
                      &rxlen, 1);
@@ -6229,12 +8125,16 @@ run_message_mode(void)
         return;
     }
 
-    rc = send_ks_cmd(KS_CMD_MSG_FLUSH, NULL, 0, NULL, 0, &status, NULL, 0);
-    if (rc == 0)
-        rc = status;
-    if (rc != 0) {
-        printf("KS Msg Flush failed: %d (%s)\n", rc, smash_err(rc));
-        return;
+    chans = (ks_features & KS_FEATURE_MSG_CHANNELS) ? KS_MSG_CHANNELS : 1;
+    for (chan = 0; chan < chans; chan++) {
+        rc = send_ks_cmd(KS_CMD_MSG_FLUSH | KS_MSG_CHANNEL(chan), NULL, 0,
+                         NULL, 0, &status, NULL, 0);
+        if (rc == 0)
+            rc = status;
+        if (rc != 0) {
+            printf("KS Msg Flush failed: %d (%s)\n", rc, smash_err(rc));
+            return;
+        }
     }
 
     while (1) {
@@ -6370,11 +8270,17 @@ int
 run_mode(uint mode, uint bank, uint baseaddr, uint len, uint report_max,
          bool fill, const char *file1, const char *file2)
 {
-    int amiga_was_put_in_reset = 0;
-    int rc;
+    int      amiga_was_put_in_reset = 0;
+    int      rc;
+    uint8_t *filebuf = NULL;
+    uint32_t image_crc = 0;
+    uint32_t fill_crc = 0;
+    uint     copies = 1;
+    uint     copy;
+    bool     write_skipped = FALSE;
 
     if (mode == MODE_UNKNOWN) {
-        warnx("You must specify one of: -e -i -r -t or -w");
+        warnx("You must specify one of: -C -e -i -r -t or -w");
         usage(stderr);
         return (1);
     }
@@ -6449,42 +8355,16 @@ run_mode(uint mode, uint bank, uint baseaddr, uint len, uint report_max,
     }
 
     get_kicksmash_mode();
+    catalog_load();
+    if (mode & MODE_CATALOG) {
+        rc = catalog_show();
+        goto finish;
+    }
     if (mode & MODE_READ) {
         eeprom_read(file1, bank, baseaddr, len);
         return (0);
     }
-    if (mode & MODE_ERASE) {
-        if (eeprom_erase(bank, baseaddr, len))
-            return (1);
-    } else if (mode & MODE_WRITE) {
-        uint temp;
-        switch (eeprom_not_erased(bank, baseaddr, len)) {
-            case -1:
-                errx(EXIT_FAILURE, "Failed to check EEPROM area erased");
-            case 0:
-                break;
-            default:
-                printf("EEPROM area has not been erased\n");
-                if (are_you_sure("Erase area before write?")) {
-                    temp = force_yes;
-                    force_yes = 1;
-                    if (eeprom_erase(bank, baseaddr, len))
-                        return (1);
-                    force_yes = temp;
-                }
-                break;
-        }
-    }
-
-    rc = 0;
     if (mode & (MODE_WRITE | MODE_VERIFY)) {
-        uint8_t *filebuf;
-        if (baseaddr == ADDR_NOT_SPECIFIED)
-            baseaddr = 0x000000;  // Start of EEPROM
-
-        if (bank != BANK_NOT_SPECIFIED)
-            baseaddr += bank * EEPROM_BANK_SIZE_DEFAULT;
-
         filebuf = file_read(file1, len);
         if (file2 != NULL) {
             uint8_t *filebuf2 = file_read(file2, len);
@@ -6508,27 +8388,85 @@ run_mode(uint mode, uint bank, uint baseaddr, uint len, uint report_max,
             filebuf = newbuf;
         }
         execute_swapmode(filebuf, len, SWAP_TO_ROM);
+        image_crc = crc32(0, filebuf, len);
 
-        do {
-            if ((mode & MODE_WRITE) &&
-                (eeprom_write(filebuf, baseaddr, len) != 0)) {
-                rc = 1;
-                break;
-            }
+        if (baseaddr == ADDR_NOT_SPECIFIED)
+            baseaddr = 0x000000;  // Start of EEPROM
 
-            if ((mode & MODE_VERIFY) &&
-                (eeprom_verify(filebuf, baseaddr, len, report_max) != 0)) {
-                rc = 1;
-                break;
-            }
+        if (bank != BANK_NOT_SPECIFIED)
+            baseaddr += bank * EEPROM_BANK_SIZE_DEFAULT;
+        bank = BANK_NOT_SPECIFIED;
 
-            baseaddr += len;
-            if (baseaddr >= EEPROM_SIZE_DEFAULT)
+        /* With fill, the image is repeated to the end of flash */
+        if (fill && (baseaddr + len < EEPROM_SIZE_DEFAULT))
+            copies = (EEPROM_SIZE_DEFAULT - baseaddr) / len;
+        for (copy = 0; copy < copies; copy++)
+            fill_crc = crc32(fill_crc, filebuf, len);
+    }
+    if (mode & MODE_ERASE) {
+        if (eeprom_erase(bank, baseaddr, len))
+            return (1);
+    } else if (mode & MODE_WRITE) {
+        uint     temp;
+        uint32_t crc;
+
+        if ((flash_crc_query(baseaddr, len * copies, &crc) == 0) &&
+            (crc == fill_crc)) {
+            printf("EEPROM at 0x%x already contains %s; skipping write\n",
+                   baseaddr, file1);
+            write_skipped = TRUE;
+            goto skip_erase_check;
+        }
+        switch (eeprom_not_erased(bank, baseaddr, len * copies)) {
+            case -1:
+                errx(EXIT_FAILURE, "Failed to check EEPROM area erased");
+            case 0:
                 break;
-        } while (fill);
+            default:
+                printf("EEPROM area has not been erased\n");
+                if (are_you_sure("Erase area before write?")) {
+                    temp = force_yes;
+                    force_yes = 1;
+                    if (eeprom_erase(bank, baseaddr, len * copies))
+                        return (1);
+                    force_yes = temp;
+                }
+                break;
+        }
+    }
+skip_erase_check:
+
+    rc = 0;
+    if (mode & (MODE_WRITE | MODE_VERIFY)) {
+        if ((mode & MODE_WRITE) && !write_skipped &&
+            (eeprom_write(filebuf, baseaddr, len, copies) != 0)) {
+            rc = 1;
+        }
+        for (copy = 0; (rc == 0) && (copy < copies); copy++) {
+            uint     addr = baseaddr + copy * len;
+            uint32_t crc;
+
+            if (mode & MODE_VERIFY) {
+                /*
+                 * Copies after the first were written from the same
+                 * stream, so a device CRC is sufficient to verify them.
+                 * A full compare reports the miscompares of a bad copy.
+                 */
+                if ((copy > 0) && (flash_crc_query(addr, len, &crc) == 0) &&
+                    (crc == image_crc)) {
+                    printf("Verify 0x%x by CRC success\n", addr);
+                } else if (eeprom_verify(filebuf, addr, len,
+                                         report_max) != 0) {
+                    rc = 1;
+                    break;
+                }
+            }
+            catalog_record(addr, len, image_crc, file1);
+        }
 
         free(filebuf);
     }
+finish:
     if (amiga_was_put_in_reset) {
         reset_amiga(0);
         time_delay_msec(100);
@@ -6586,6 +8524,7 @@ main(int argc, char * const *argv)
     uint             baseaddr   = ADDR_NOT_SPECIFIED;
     uint             len        = EEPROM_SIZE_NOT_SPECIFIED;
     uint             report_max = 64;
+    uint             prof_msec  = 0;
     char            *file1      = NULL;
     char            *file2      = NULL;
     uint             mode       = MODE_UNKNOWN;
@@ -6636,6 +8575,12 @@ errx(EXIT_FAILURE, "how did we get here?");
                     errx(EXIT_FAILURE, "Invalid bank \"%s\"", optarg);
                 }
                 break;
+            case 'C':
+                if (mode != MODE_UNKNOWN)
+                    errx(EXIT_FAILURE,
+                         "-%c may not be specified with any other mode", ch);
+                mode = MODE_CATALOG;
+                break;
             case 'c':
                 if (strcmp(optarg, "set") == 0) {
                     mode |= MODE_CLOCK_GET;
@@ -6683,6 +8628,15 @@ errx(EXIT_FAILURE, "how did we get here?");
                 volume_add(optarg, argv[optind], (ch == 'M'));
                 optind++;
                 break;
+            case 'P':
+                if (mode != MODE_UNKNOWN)
+                    errx(EXIT_FAILURE,
+                         "-%c may not be specified with any other mode", ch);
+                prof_msec = atou(optarg);
+                if (prof_msec == 0)
+                    errx(EXIT_FAILURE, "Invalid profile time \"%s\"", optarg);
+                mode = MODE_PROFILE;
+                break;
             case 'r':
                 if (mode != MODE_UNKNOWN)
                     errx(EXIT_FAILURE,
@@ -6759,6 +8713,12 @@ errx(EXIT_FAILURE, "how did we get here?");
     argc -= optind;
     argv += optind;
 
+    if ((mode & MODE_PROFILE) && (argc > 0)) {
+        /* Optional symbol map filename */
+        file1 = argv[0];
+        argv++;
+        argc--;
+    }
     if (mode & (MODE_READ | MODE_WRITE | MODE_VERIFY)) {
         /* First two arguments are filenames */
         if (argc > 0) {
@@ -6809,7 +8769,10 @@ errx(EXIT_FAILURE, "how did we get here?");
         do_exit(EXIT_FAILURE);
 
     create_threads();
-    rc = run_mode(mode, bank, baseaddr, len, report_max, fill, file1, file2);
+    if (mode & MODE_PROFILE)
+        rc = profile_rom(prof_msec, file1, report_max);
+    else
+        rc = run_mode(mode, bank, baseaddr, len, report_max, fill, file1, file2);
     wait_for_tx_writer();
 
     exit(rc);
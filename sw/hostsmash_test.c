@@ -0,0 +1,130 @@
+/*
+ * Host-side tests for hostsmash file service functions which do not
+ * require a Kicksmash to be attached.
+ *
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ */
+
+#define main hostsmash_main
+#include "hostsmash.c"
+#undef main
+
+static uint test_failures = 0;
+
+#define TEST_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+static char *
+test_path(const char *base, const char *name)
+{
+    char *path = malloc(strlen(base) + strlen(name) + 2);
+    sprintf(path, "%s/%s", base, name);
+    return (path);
+}
+
+static int
+test_host_case_sensitive(const char *base)
+{
+    char *upper = test_path(base, "CASE_PROBE");
+    char *lower = test_path(base, "case_probe");
+    struct stat st;
+    int   sensitive;
+
+    mkdir(upper, 0755);
+    sensitive = (stat(lower, &st) != 0);
+    rmdir(upper);
+    free(upper);
+    free(lower);
+    return (sensitive);
+}
+
+/*
+ * Creating a directory whose name differs only in case from an existing
+ * directory must fail with EEXIST, as AmigaDOS names are not case
+ * sensitive.
+ */
+static void
+test_create_existing_other_case(amiga_vol_t *vol)
+{
+    char *path;
+
+    path = test_path(vol->av_path, "Foo");
+    TEST_CHECK(mkdir(path, 0755) == 0);
+    free(path);
+
+    path = make_host_path(vol, "foo");
+    TEST_CHECK(strcmp(path + strlen(path) - 3, "Foo") == 0);
+    errno = 0;
+    TEST_CHECK((mkdir(path, 0755) != 0) && (errno == EEXIST));
+    free(path);
+
+    path = test_path(vol->av_path, "Foo");
+    rmdir(path);
+    free(path);
+}
+
+/*
+ * A rename which only changes case keeps the new name as given. A rename
+ * onto a different existing entry must resolve to that entry's name so
+ * that it is replaced.
+ */
+static void
+test_rename_case(amiga_vol_t *vol)
+{
+    char *old_path = test_path(vol->av_path, "Bar");
+    char *other    = test_path(vol->av_path, "baz");
+    char *path;
+    FILE *fp;
+
+    if ((fp = fopen(old_path, "w")) != NULL)
+        fclose(fp);
+    if ((fp = fopen(other, "w")) != NULL)
+        fclose(fp);
+
+    path = make_host_rename_path(vol, "BAR", old_path);
+    TEST_CHECK(strcmp(path + strlen(path) - 3, "BAR") == 0);
+    free(path);
+
+    path = make_host_rename_path(vol, "BAZ", old_path);
+    TEST_CHECK(strcmp(path, other) == 0);
+    free(path);
+
+    unlink(old_path);
+    unlink(other);
+    free(old_path);
+    free(other);
+}
+
+int
+main(void)
+{
+    char        base[] = "/tmp/hostsmash_test.XXXXXX";
+    amiga_vol_t vol;
+
+    if (mkdtemp(base) == NULL)
+        err(EXIT_FAILURE, "mkdtemp");
+    memset(&vol, 0, sizeof (vol));
+    vol.av_volume = "Test";
+    vol.av_path   = base;
+
+    if (test_host_case_sensitive(base)) {
+        test_create_existing_other_case(&vol);
+        test_rename_case(&vol);
+    } else {
+        printf("Host file system is not case sensitive; skipping\n");
+    }
+    rmdir(base);
+
+    if (test_failures != 0) {
+        printf("%u test failures\n", test_failures);
+        return (EXIT_FAILURE);
+    }
+    printf("PASS\n");
+    return (EXIT_SUCCESS);
+}